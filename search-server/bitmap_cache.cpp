@@ -0,0 +1,61 @@
+#include "bitmap_cache.h"
+
+#include <unordered_set>
+
+using namespace std;
+
+BitmapCache::BitmapCache(size_t capacity)
+    : capacity_(capacity) {
+}
+
+BitmapCache::BitmapCache(const BitmapCache& other)
+    : capacity_(other.capacity_) {
+}
+
+BitmapCache& BitmapCache::operator=(const BitmapCache& other) {
+    if (this != &other) {
+        lock_guard guard(mutex_);
+        capacity_ = other.capacity_;
+        bitmaps_.clear();
+        insertion_order_.clear();
+    }
+    return *this;
+}
+
+void BitmapCache::Invalidate(TermId term) {
+    lock_guard guard(mutex_);
+    bitmaps_.erase(term);
+}
+
+void BitmapCache::Clear() {
+    lock_guard guard(mutex_);
+    bitmaps_.clear();
+    insertion_order_.clear();
+}
+
+shared_ptr<const DocumentBitmap> BitmapCache::Insert(TermId term, shared_ptr<const DocumentBitmap> bitmap) {
+    lock_guard guard(mutex_);
+    const auto [it, inserted] = bitmaps_.emplace(term, move(bitmap));
+    if (!inserted) {
+        // another query built it in the meantime
+        return it->second;
+    }
+    auto result = it->second;
+    insertion_order_.push_back(term);
+    while (bitmaps_.size() > capacity_ && !insertion_order_.empty()) {
+        bitmaps_.erase(insertion_order_.front());
+        insertion_order_.pop_front();
+    }
+    if (insertion_order_.size() > 2 * capacity_ + 1) {
+        // drop invalidated terms and repeats, keeping the newest position of every term
+        deque<TermId> insertion_order;
+        unordered_set<TermId> seen;
+        for (auto order_it = insertion_order_.rbegin(); order_it != insertion_order_.rend(); ++order_it) {
+            if (bitmaps_.count(*order_it) && seen.insert(*order_it).second) {
+                insertion_order.push_front(*order_it);
+            }
+        }
+        insertion_order_ = move(insertion_order);
+    }
+    return result;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "document_bitmap.h"
+#include "term_dictionary.h"
+
+// Document bitmaps of terms shared between queries, which may use the cache from several
+// threads at once. The owner invalidates a term whenever its postings change. When full,
+// the oldest entry is dropped.
+class BitmapCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 256;
+
+    explicit BitmapCache(size_t capacity = DEFAULT_CAPACITY);
+
+    // A copy starts empty; the cache is only an accelerator of the index it belongs to
+    BitmapCache(const BitmapCache& other);
+    BitmapCache& operator=(const BitmapCache& other);
+
+    // Returns the cached bitmap of the term or caches the one build() returns
+    template <typename Builder>
+    std::shared_ptr<const DocumentBitmap> Get(TermId term, Builder build);
+
+    void Invalidate(TermId term);
+
+    // Drops every bitmap, for when the owner renumbers its documents
+    void Clear();
+
+private:
+    size_t capacity_;
+    std::mutex mutex_;
+    std::unordered_map<TermId, std::shared_ptr<const DocumentBitmap>> bitmaps_;
+    // may also hold invalidated terms, which are skipped on eviction
+    std::deque<TermId> insertion_order_;
+
+    std::shared_ptr<const DocumentBitmap> Insert(TermId term, std::shared_ptr<const DocumentBitmap> bitmap);
+};
+
+template <typename Builder>
+std::shared_ptr<const DocumentBitmap> BitmapCache::Get(TermId term, Builder build) {
+    {
+        std::lock_guard guard(mutex_);
+        if (const auto it = bitmaps_.find(term); it != bitmaps_.end()) {
+            return it->second;
+        }
+    }
+    // built without the lock, so a miss does not stall queries hitting other terms
+    return Insert(term, std::make_shared<const DocumentBitmap>(build()));
+}
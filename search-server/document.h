@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <string_view>
+#include <vector>
 
 struct Document {
     Document() = default;
@@ -12,6 +15,9 @@ struct Document {
     int rating = 0;
 };
 
+// Internal dense number of a document, assigned in the order documents are added
+using DocumentOrdinal = uint32_t;
+
 enum class DocumentStatus {
     ACTUAL,
     IRRELEVANT,
@@ -19,4 +25,12 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// A document waiting to be indexed; text must stay alive until it is added
+struct NewDocument {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 std::ostream& operator<<(std::ostream& os, const Document& doc);
\ No newline at end of file
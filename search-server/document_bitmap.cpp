@@ -0,0 +1,57 @@
+#include "document_bitmap.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void DocumentBitmap::Add(DocumentOrdinal ordinal) {
+    const size_t high = ordinal >> 16;
+    const auto low = static_cast<uint16_t>(ordinal);
+    if (containers_.size() <= high) {
+        containers_.resize(high + 1);
+    }
+    Container& container = containers_[high];
+    if (!container.bits.empty()) {
+        container.bits[low >> 6] |= uint64_t{1} << (low & 63);
+        return;
+    }
+    auto& array = container.array;
+    if (array.empty() || array.back() < low) {
+        array.push_back(low);
+    } else {
+        const auto it = lower_bound(array.begin(), array.end(), low);
+        if (*it == low) {
+            return;
+        }
+        array.insert(it, low);
+    }
+    if (container.array.size() > MAX_ARRAY_SIZE) {
+        container.bits.assign(CONTAINER_BITS / 64, 0);
+        for (const uint16_t value : container.array) {
+            container.bits[value >> 6] |= uint64_t{1} << (value & 63);
+        }
+        container.array.clear();
+        container.array.shrink_to_fit();
+    }
+}
+
+bool DocumentBitmap::Contains(DocumentOrdinal ordinal) const {
+    const size_t high = ordinal >> 16;
+    if (high >= containers_.size()) {
+        return false;
+    }
+    const auto low = static_cast<uint16_t>(ordinal);
+    const Container& container = containers_[high];
+    if (!container.bits.empty()) {
+        return (container.bits[low >> 6] >> (low & 63)) & 1;
+    }
+    return binary_search(container.array.begin(), container.array.end(), low);
+}
+
+size_t DocumentBitmap::GetMemoryUsage() const {
+    size_t usage = containers_.capacity() * sizeof(Container);
+    for (const Container& container : containers_) {
+        usage += container.array.capacity() * sizeof(uint16_t) + container.bits.capacity() * sizeof(uint64_t);
+    }
+    return usage;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "document.h"
+
+// Compressed set of document ordinals in the style of a roaring bitmap: ordinals are
+// grouped by their high 16 bits, and each group is a sorted array of the low bits while
+// it is sparse or a plain 65536 bit set once it gets dense.
+class DocumentBitmap {
+public:
+    // Adding in ascending order appends; other orders insert into a sorted array
+    void Add(DocumentOrdinal ordinal);
+
+    bool Contains(DocumentOrdinal ordinal) const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr size_t CONTAINER_BITS = 1 << 16;
+    // an array of more low bits would be larger than the bit set
+    static constexpr size_t MAX_ARRAY_SIZE = CONTAINER_BITS / 16;
+
+    struct Container {
+        std::vector<uint16_t> array;
+        std::vector<uint64_t> bits;
+    };
+
+    // indexed by the high bits of the ordinal; ordinals are dense, so there are few
+    std::vector<Container> containers_;
+};
@@ -0,0 +1,53 @@
+#include "document_fingerprint.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+// splitmix64 finalizer
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111eb;
+    value ^= value >> 31;
+    return value;
+}
+
+} // namespace
+
+uint64_t ComputeWordHash(string_view word) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    for (const char c : word) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3;
+    }
+    return Mix(hash);
+}
+
+uint64_t ComputeDocumentFingerprint(vector<uint64_t>& word_hashes) {
+    sort(word_hashes.begin(), word_hashes.end());
+    uint64_t fingerprint = Mix(word_hashes.size());
+    for (const uint64_t word_hash : word_hashes) {
+        fingerprint = Mix(fingerprint ^ word_hash);
+    }
+    return fingerprint;
+}
+
+MinHashSignature ComputeMinHashSignature(const vector<uint64_t>& word_hashes) {
+    MinHashSignature signature;
+    signature.fill(numeric_limits<uint32_t>::max());
+    for (const uint64_t word_hash : word_hashes) {
+        // every pair of hash functions takes the two halves of one mixed value
+        for (size_t i = 0; i < MINHASH_SIZE; i += 2) {
+            const uint64_t value = Mix(word_hash + 0x9e3779b97f4a7c15 * (i + 1));
+            signature[i] = min(signature[i], static_cast<uint32_t>(value));
+            signature[i + 1] = min(signature[i + 1], static_cast<uint32_t>(value >> 32));
+        }
+    }
+    return signature;
+}
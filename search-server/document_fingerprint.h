@@ -0,0 +1,23 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Number of hash functions of a MinHash signature
+const size_t MINHASH_SIZE = 64;
+
+using MinHashSignature = std::array<uint32_t, MINHASH_SIZE>;
+
+// 64-bit hash of a word that is the same on every platform, so fingerprints can be saved
+uint64_t ComputeWordHash(std::string_view word);
+
+// Fingerprint of a set of words given by their hashes in any order; equal sets have equal
+// fingerprints and different sets collide with probability about 2^-64. Sorts word_hashes.
+uint64_t ComputeDocumentFingerprint(std::vector<uint64_t>& word_hashes);
+
+// The minimum of every one of MINHASH_SIZE hash functions over the words. The share of
+// equal positions in two signatures estimates the Jaccard similarity of the word sets.
+MinHashSignature ComputeMinHashSignature(const std::vector<uint64_t>& word_hashes);
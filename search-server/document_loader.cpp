@@ -0,0 +1,143 @@
+#include "document_loader.h"
+
+#include <charconv>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+#include "parallel_for.h"
+
+using namespace std;
+
+namespace {
+
+// Reads whole lines only; the incomplete last line is kept in tail for the next chunk
+string ReadChunk(istream& input, string& tail, size_t chunk_size) {
+    string chunk = move(tail);
+    tail.clear();
+    size_t last_line_end = string::npos;
+    while (input && last_line_end == string::npos) {
+        const size_t size = chunk.size();
+        chunk.resize(size + chunk_size);
+        input.read(chunk.data() + size, chunk_size);
+        chunk.resize(size + input.gcount());
+        last_line_end = chunk.rfind('\n');
+    }
+    if (input) {
+        tail = chunk.substr(last_line_end + 1);
+        chunk.resize(last_line_end + 1);
+    }
+    return chunk;
+}
+
+DocumentStatus ParseStatus(string_view text) {
+    if (text == "ACTUAL"sv) {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT"sv) {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED"sv) {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED"sv) {
+        return DocumentStatus::REMOVED;
+    }
+    throw invalid_argument("unknown document status "s + string(text));
+}
+
+int ParseInt(string_view text) {
+    int value = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc() || end != text.data() + text.size()) {
+        throw invalid_argument("invalid number "s + string(text));
+    }
+    return value;
+}
+
+NewDocument ParseDocument(string_view line) {
+    string_view fields[3];
+    for (string_view& field : fields) {
+        const size_t tab = line.find('\t');
+        if (tab == string_view::npos) {
+            throw invalid_argument("expected id, status, ratings and text separated by tabs"s);
+        }
+        field = line.substr(0, tab);
+        line.remove_prefix(tab + 1);
+    }
+    NewDocument document;
+    document.id = ParseInt(fields[0]);
+    document.status = ParseStatus(fields[1]);
+    for (const string_view rating : SplitIntoWords(fields[2])) {
+        document.ratings.push_back(ParseInt(rating));
+    }
+    document.text = line;
+    return document;
+}
+
+// Returns the number of lines in the chunk, documents or not
+size_t AddChunk(SearchServer& search_server, const string& chunk, size_t first_line_number) {
+    vector<string_view> lines;
+    vector<size_t> line_numbers;
+    string_view rest = chunk;
+    size_t line_number = first_line_number;
+    while (!rest.empty()) {
+        size_t line_end = rest.find('\n');
+        string_view line = rest.substr(0, line_end);
+        rest.remove_prefix(line_end == string_view::npos ? rest.size() : line_end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            lines.push_back(line);
+            line_numbers.push_back(line_number);
+        }
+        ++line_number;
+    }
+
+    const size_t slice_count = max(1u, thread::hardware_concurrency());
+    vector<NewDocument> documents(lines.size());
+    ParallelForSlices(lines.size(), slice_count, [&](size_t, size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            try {
+                documents[i] = ParseDocument(lines[i]);
+            } catch (const invalid_argument& e) {
+                throw invalid_argument("line "s + to_string(line_numbers[i]) + ": "s + e.what());
+            }
+        }
+    });
+
+    search_server.AddDocuments(execution::par, documents);
+    return line_number - first_line_number;
+}
+
+}
+
+size_t LoadDocuments(SearchServer& search_server, istream& input, size_t chunk_size) {
+    const int document_count_before = search_server.GetDocumentCount();
+    string tail;
+    string chunk = ReadChunk(input, tail, chunk_size);
+    size_t line_number = 1;
+    while (!chunk.empty()) {
+        future<string> next_chunk = async(launch::async, ReadChunk, ref(input), ref(tail), chunk_size);
+        try {
+            line_number += AddChunk(search_server, chunk, line_number);
+        } catch (...) {
+            next_chunk.wait();
+            throw;
+        }
+        chunk = next_chunk.get();
+    }
+    // the chunks sealed the lists they extended; this gives back the room reserved for them
+    search_server.CompactPostings();
+    return search_server.GetDocumentCount() - document_count_before;
+}
+
+size_t LoadDocumentsFromFile(SearchServer& search_server, const string& path, size_t chunk_size) {
+    ifstream input(path, ios::binary);
+    if (!input) {
+        throw runtime_error("cannot open "s + path);
+    }
+    return LoadDocuments(search_server, input, chunk_size);
+}
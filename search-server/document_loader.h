@@ -0,0 +1,19 @@
+#pragma once
+
+#include <istream>
+#include <string>
+
+#include "search_server.h"
+
+const size_t DEFAULT_LOAD_CHUNK_SIZE = 16 << 20;
+
+// Adds documents stored one per line as "id<TAB>status<TAB>ratings<TAB>text", where status
+// is a DocumentStatus name (ACTUAL, IRRELEVANT, BANNED, REMOVED) and ratings are integers
+// separated by spaces, possibly none. Input is read in chunks of about chunk_size bytes;
+// while one chunk is parsed and tokenized on all cores, the next one is being read.
+// Posting lists are sealed and shrunk once the input ends. Returns the number of documents added.
+size_t LoadDocuments(SearchServer& search_server, std::istream& input,
+                     size_t chunk_size = DEFAULT_LOAD_CHUNK_SIZE);
+
+size_t LoadDocumentsFromFile(SearchServer& search_server, const std::string& path,
+                             size_t chunk_size = DEFAULT_LOAD_CHUNK_SIZE);
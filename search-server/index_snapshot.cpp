@@ -0,0 +1,179 @@
+#include "index_snapshot.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+size_t AlignSection(size_t bytes) {
+    return (bytes + 7) & ~size_t{7};
+}
+
+void CheckOffsets(const uint64_t* offsets, size_t count, uint64_t total) {
+    SnapshotReader::Check(offsets[0] == 0 && offsets[count] == total);
+    for (size_t i = 0; i < count; ++i) {
+        SnapshotReader::Check(offsets[i] <= offsets[i + 1]);
+    }
+}
+
+}
+
+MappedFile::MappedFile(const string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("cannot open snapshot "s + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw runtime_error("cannot stat snapshot "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    void* data = size_ ? mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw runtime_error("cannot map snapshot "s + path);
+    }
+    data_ = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+const char* MappedFile::data() const {
+    return data_;
+}
+
+size_t MappedFile::size() const {
+    return size_;
+}
+
+SnapshotWriter::SnapshotWriter(const string& path)
+    : path_(path)
+    // in the same directory, so the rename stays within one file system
+    , temp_path_(path + ".tmp."s + to_string(getpid()))
+    , out_(temp_path_, ios::binary | ios::trunc) {
+    if (!out_) {
+        throw runtime_error("cannot create snapshot "s + temp_path_);
+    }
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (!is_finished_) {
+        out_.close();
+        unlink(temp_path_.c_str());
+    }
+}
+
+void SnapshotWriter::WriteHeader(const SnapshotHeader& header) {
+    WriteArray(&header, 1);
+    FinishSection();
+}
+
+void SnapshotWriter::WriteStrings(const vector<string_view>& strings) {
+    uint64_t offset = 0;
+    WriteArray(&offset, 1);
+    for (const string_view str : strings) {
+        offset += str.size();
+        WriteArray(&offset, 1);
+    }
+    for (const string_view str : strings) {
+        WriteArray(str.data(), str.size());
+    }
+    FinishSection();
+}
+
+void SnapshotWriter::FinishSection() {
+    const size_t position = static_cast<size_t>(out_.tellp());
+    const char padding[8] = {};
+    out_.write(padding, AlignSection(position) - position);
+}
+
+void SnapshotWriter::Finish(const SnapshotHeader& header) {
+    out_.seekp(0);
+    WriteArray(&header, 1);
+    out_.close();
+    if (!out_) {
+        throw runtime_error("failed to write snapshot "s + temp_path_);
+    }
+    // the data must reach the disk before the rename does, or a crash could leave an empty snapshot
+    const int fd = open(temp_path_.c_str(), O_RDONLY);
+    if (fd < 0 || fsync(fd) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw runtime_error("cannot sync snapshot "s + temp_path_);
+    }
+    close(fd);
+    // readers mapping the old file keep its pages until they unmap it
+    if (rename(temp_path_.c_str(), path_.c_str()) != 0) {
+        throw runtime_error("cannot replace snapshot "s + path_);
+    }
+    is_finished_ = true;
+}
+
+SnapshotReader::SnapshotReader(const MappedFile& file)
+    : file_(file) {
+}
+
+const SnapshotHeader& SnapshotReader::ReadHeader() {
+    const SnapshotHeader& header = *ReadArray<SnapshotHeader>(1);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version != SNAPSHOT_VERSION) {
+        throw runtime_error("not a search server snapshot of version "s + to_string(SNAPSHOT_VERSION));
+    }
+    // every element takes at least a byte, and counts plus one must not overflow
+    for (const uint64_t count : {header.stop_word_count, header.term_count, header.posting_block_count,
+                                 header.posting_data_size, header.document_count, header.document_term_count}) {
+        if (count >= file_.size()) {
+            throw runtime_error("snapshot is truncated"s);
+        }
+    }
+    return header;
+}
+
+vector<string_view> SnapshotReader::ReadStrings(size_t count) {
+    // the characters follow the offsets, which end on an 8 byte boundary
+    const uint64_t* offsets = ReadArray<uint64_t>(count + 1);
+    const char* chars = ReadArray<char>(offsets[count]);
+    CheckOffsets(offsets, count, offsets[count]);
+
+    vector<string_view> strings;
+    strings.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        strings.emplace_back(chars + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    return strings;
+}
+
+const uint64_t* SnapshotReader::ReadOffsets(size_t count, uint64_t total) {
+    const uint64_t* offsets = ReadArray<uint64_t>(count + 1);
+    CheckOffsets(offsets, count, total);
+    return offsets;
+}
+
+void SnapshotReader::Check(bool condition) {
+    if (!condition) {
+        throw runtime_error("snapshot is corrupted"s);
+    }
+}
+
+const char* SnapshotReader::Advance(size_t bytes) {
+    if (file_.size() < position_ || file_.size() - position_ < bytes) {
+        throw runtime_error("snapshot is truncated"s);
+    }
+    const char* data = file_.data() + position_;
+    position_ = AlignSection(position_ + bytes);
+    return data;
+}
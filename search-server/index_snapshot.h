@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Snapshot file layout: SnapshotHeader followed by these sections, each padded to 8 bytes
+// so that every array can be used in place once the file is mapped:
+//   stop words      uint64 offsets[stop_word_count + 1], chars
+//   terms           uint64 offsets[term_count + 1], chars (position is the TermId)
+//   postings        uint64 block offsets[term_count + 1], uint64 data offsets[term_count + 1],
+//                   PostingList::Block blocks[posting_block_count], uint8 data[posting_data_size]
+//   documents       int32 ids[document_count], int32 ratings[document_count],
+//                   DocumentStatus statuses[document_count], uint64 fingerprints[document_count]
+//   document terms  uint64 offsets[document_count + 1], uint32 terms[document_term_count],
+//                   double term_freqs[document_term_count]
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t version;
+    uint64_t stop_word_count;
+    uint64_t term_count;
+    uint64_t posting_block_count;
+    uint64_t posting_data_size;
+    uint64_t document_count;
+    uint64_t document_term_count;
+};
+
+// Read-only shared mapping of a whole file, so processes opening the same
+// snapshot share its pages in the page cache
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const;
+    size_t size() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Writes to a temporary file next to path and renames it over path in Finish, so a
+// snapshot mapped by this or another process is never truncated under its readers
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path);
+    // Removes the temporary file unless Finish succeeded
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    void WriteHeader(const SnapshotHeader& header);
+
+    template <typename T>
+    void WriteArray(const T* data, size_t size);
+
+    // Writes offsets and characters of the strings as one section
+    void WriteStrings(const std::vector<std::string_view>& strings);
+
+    // Pads the current section to the 8 byte boundary
+    void FinishSection();
+
+    // Rewrites the header at the start of the file, syncs it to disk and replaces path with it
+    void Finish(const SnapshotHeader& header);
+
+private:
+    std::string path_;
+    std::string temp_path_;
+    std::ofstream out_;
+    bool is_finished_ = false;
+};
+
+// Checks every count and offset it reads against the file, so a corrupted snapshot is
+// rejected with std::runtime_error instead of being read out of bounds
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const MappedFile& file);
+
+    // No count in the header may exceed the file size
+    const SnapshotHeader& ReadHeader();
+
+    // Returns a pointer into the mapping and skips the section padding
+    template <typename T>
+    const T* ReadArray(size_t size);
+
+    std::vector<std::string_view> ReadStrings(size_t count);
+
+    // Reads offsets[count + 1] into a section of total elements; they must start at zero,
+    // never decrease and end at total
+    const uint64_t* ReadOffsets(size_t count, uint64_t total);
+
+    // Throws std::runtime_error unless the condition on the snapshot's contents holds
+    static void Check(bool condition);
+
+private:
+    const MappedFile& file_;
+    size_t position_ = 0;
+
+    const char* Advance(size_t bytes);
+};
+
+const char SNAPSHOT_MAGIC[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0'};
+const uint64_t SNAPSHOT_VERSION = 3;
+
+template <typename T>
+void SnapshotWriter::WriteArray(const T* data, size_t size) {
+    out_.write(reinterpret_cast<const char*>(data), sizeof(T) * size);
+}
+
+template <typename T>
+const T* SnapshotReader::ReadArray(size_t size) {
+    // a corrupted count must not wrap the byte count around
+    if (size > file_.size() / sizeof(T)) {
+        throw std::runtime_error("snapshot is truncated");
+    }
+    const char* data = Advance(sizeof(T) * size);
+    return reinterpret_cast<const T*>(data);
+}
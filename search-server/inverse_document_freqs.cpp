@@ -0,0 +1,22 @@
+#include "inverse_document_freqs.h"
+
+using namespace std;
+
+InverseDocumentFreqTable::Entry::Entry(const Entry& other)
+    : value(other.value.load(memory_order_relaxed))
+    , epoch(other.epoch.load(memory_order_relaxed)) {
+}
+
+InverseDocumentFreqTable::Entry& InverseDocumentFreqTable::Entry::operator=(const Entry& other) {
+    value.store(other.value.load(memory_order_relaxed), memory_order_relaxed);
+    epoch.store(other.epoch.load(memory_order_relaxed), memory_order_relaxed);
+    return *this;
+}
+
+void InverseDocumentFreqTable::Resize(size_t term_count) {
+    entries_.resize(term_count);
+}
+
+void InverseDocumentFreqTable::Invalidate() {
+    ++epoch_;
+}
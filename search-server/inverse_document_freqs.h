@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "term_dictionary.h"
+
+// IDF of every term, computed on first use after the document count last changed.
+// Any change of the document count starts a new epoch, which invalidates every entry
+// at once. Queries may look up concurrently: entries they fill for the same epoch get
+// identical values, and the epoch is published after the value.
+class InverseDocumentFreqTable {
+public:
+    // Keeps the entries of existing terms
+    void Resize(size_t term_count);
+
+    void Invalidate();
+
+    // Returns the stored IDF of the term or stores and returns compute()
+    template <typename Compute>
+    double Get(TermId term, Compute compute) const;
+
+private:
+    struct Entry {
+        Entry() = default;
+        Entry(const Entry& other);
+        Entry& operator=(const Entry& other);
+
+        std::atomic<double> value{0.0};
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    mutable std::vector<Entry> entries_;
+    // entries start at epoch 0, so they are stale until computed
+    uint64_t epoch_ = 1;
+};
+
+template <typename Compute>
+double InverseDocumentFreqTable::Get(TermId term, Compute compute) const {
+    Entry& entry = entries_[term];
+    if (entry.epoch.load(std::memory_order_acquire) == epoch_) {
+        return entry.value.load(std::memory_order_relaxed);
+    }
+    const double value = compute();
+    entry.value.store(value, std::memory_order_relaxed);
+    entry.epoch.store(epoch_, std::memory_order_release);
+    return value;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Array that either owns its elements or views read-only memory owned by someone
+// else, such as a mapped index snapshot. The first mutation of a view copies the
+// elements to the heap, so untouched data is served straight from the mapping.
+template <typename T>
+class MappedArray {
+public:
+    MappedArray() = default;
+
+    MappedArray(std::vector<T> elements)
+        : owned_(std::move(elements)) {
+    }
+
+    // The viewed memory must outlive the array and every copy of it
+    static MappedArray View(const T* data, size_t size) {
+        MappedArray result;
+        result.view_ = data;
+        result.view_size_ = size;
+        return result;
+    }
+
+    const T* data() const {
+        return view_ ? view_ : owned_.data();
+    }
+
+    size_t size() const {
+        return view_ ? view_size_ : owned_.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    const T& operator[](size_t index) const {
+        return data()[index];
+    }
+
+    const T* begin() const {
+        return data();
+    }
+
+    const T* end() const {
+        return data() + size();
+    }
+
+    const T& back() const {
+        return data()[size() - 1];
+    }
+
+    bool IsView() const {
+        return view_ != nullptr;
+    }
+
+    size_t GetMemoryUsage() const {
+        return owned_.capacity() * sizeof(T);
+    }
+
+    std::vector<T>& Mutable() {
+        if (view_) {
+            owned_.assign(view_, view_ + view_size_);
+            view_ = nullptr;
+            view_size_ = 0;
+        }
+        return owned_;
+    }
+
+    // Gives back the spare capacity of owned elements; a view has none
+    void ShrinkToFit() {
+        owned_.shrink_to_fit();
+    }
+
+    void push_back(const T& value) {
+        Mutable().push_back(value);
+    }
+
+private:
+    std::vector<T> owned_;
+    const T* view_ = nullptr;
+    size_t view_size_ = 0;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <execution>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+// Splits [0, count) into slice_count contiguous slices and runs
+// function(slice, first, last) for all of them in parallel.
+// An exception escaping a std::execution algorithm calls std::terminate, so the first
+// exception thrown by any slice is caught and rethrown here once all slices are done.
+template <typename Function>
+void ParallelForSlices(size_t count, size_t slice_count, Function function) {
+    slice_count = std::max<size_t>(1, std::min(slice_count, count));
+    std::vector<size_t> slices(slice_count);
+    std::iota(slices.begin(), slices.end(), 0);
+
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::for_each(std::execution::par, slices.begin(), slices.end(), [&](size_t slice) {
+        try {
+            function(slice, count * slice / slice_count, count * (slice + 1) / slice_count);
+        } catch (...) {
+            std::lock_guard guard(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,12 @@
+#include "partial_index.h"
+
+using namespace std;
+
+uint32_t PartialIndex::AddTerm(string_view term) {
+    const auto [it, inserted] = term_numbers.emplace(term, static_cast<uint32_t>(terms.size()));
+    if (inserted) {
+        terms.push_back(term);
+        postings.emplace_back();
+    }
+    return it->second;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+
+// Index of a batch of documents built away from SearchServer. Terms are views into the
+// documents' text and documents are numbered by their position in the batch, so several
+// partial indexes can be built on separate threads and merged into the server afterwards.
+struct PartialIndex {
+    struct DocumentEntry {
+        int id;
+        int rating;
+        DocumentStatus status;
+        // local term numbers, ascending, with the term frequency of each
+        std::vector<uint32_t> terms;
+        std::vector<double> term_freqs;
+        // of the document's word set, see ComputeDocumentFingerprint
+        uint64_t fingerprint;
+    };
+
+    struct Posting {
+        uint32_t document;
+        uint32_t term_count;
+        // words of the document, stop words excluded
+        uint32_t document_length;
+    };
+
+    std::vector<DocumentEntry> documents;
+    // indexed by local term number
+    std::vector<std::string_view> terms;
+    std::vector<std::vector<Posting>> postings;
+    std::unordered_map<std::string_view, uint32_t> term_numbers;
+
+    uint32_t AddTerm(std::string_view term);
+};
@@ -0,0 +1,370 @@
+#include "posting_list.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+void WriteVarint(uint32_t value, vector<uint8_t>& data) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+bool OrdinalLess(const PostingList::Posting& posting, DocumentOrdinal ordinal) {
+    return posting.ordinal < ordinal;
+}
+
+} // namespace
+
+PostingList PostingList::View(const Block* blocks, size_t block_count, const uint8_t* data, size_t data_size) {
+    PostingList result;
+    result.blocks_ = MappedArray<Block>::View(blocks, block_count);
+    result.data_ = MappedArray<uint8_t>::View(data, data_size);
+    for (size_t i = 0; i < block_count; ++i) {
+        result.document_freq_ += blocks[i].size;
+    }
+    return result;
+}
+
+void PostingList::Add(DocumentOrdinal ordinal, uint32_t term_count, uint32_t document_length) {
+    const Posting posting{ordinal, term_count, document_length};
+    const size_t block_index = FindBlock(ordinal);
+    if (block_index == blocks_.size()) {
+        const auto it = lower_bound(tail_.begin(), tail_.end(), ordinal, OrdinalLess);
+        if (it != tail_.end() && it->ordinal == ordinal) {
+            it->term_count += term_count;
+            return;
+        }
+        tail_.insert(it, posting);
+        ++document_freq_;
+        if (tail_.size() == BLOCK_SIZE) {
+            EncodeTail();
+        }
+        return;
+    }
+
+    vector<Posting> postings = DecodeBlock(block_index);
+    const auto it = lower_bound(postings.begin(), postings.end(), ordinal, OrdinalLess);
+    if (it != postings.end() && it->ordinal == ordinal) {
+        it->term_count += term_count;
+    } else {
+        postings.insert(it, posting);
+        ++document_freq_;
+    }
+    RewriteBlock(block_index, postings);
+}
+
+void PostingList::Reserve(size_t additional) {
+    // most postings take three or four bytes
+    auto& data = data_.Mutable();
+    const size_t required = data.size() + additional * 4;
+    if (required > data.capacity()) {
+        // keep the geometric growth, or a stream of small batches would reallocate on every one
+        data.reserve(max(required, data.capacity() * 2));
+    }
+    auto& blocks = blocks_.Mutable();
+    const size_t required_blocks = blocks.size() + additional / BLOCK_SIZE + 1;
+    if (required_blocks > blocks.capacity()) {
+        blocks.reserve(max(required_blocks, blocks.capacity() * 2));
+    }
+}
+
+bool PostingList::Remove(DocumentOrdinal ordinal) {
+    const size_t block_index = FindBlock(ordinal);
+    if (block_index == blocks_.size()) {
+        const auto it = lower_bound(tail_.begin(), tail_.end(), ordinal, OrdinalLess);
+        if (it == tail_.end() || it->ordinal != ordinal) {
+            return false;
+        }
+        tail_.erase(it);
+        --document_freq_;
+        return true;
+    }
+    if (blocks_[block_index].first_ordinal > ordinal) {
+        return false;
+    }
+
+    vector<Posting> postings = DecodeBlock(block_index);
+    const auto it = lower_bound(postings.begin(), postings.end(), ordinal, OrdinalLess);
+    if (it == postings.end() || it->ordinal != ordinal) {
+        return false;
+    }
+    postings.erase(it);
+    --document_freq_;
+    RewriteBlock(block_index, postings);
+    return true;
+}
+
+size_t PostingList::Remove(const vector<DocumentOrdinal>& ordinals) {
+    vector<Block> blocks;
+    vector<uint8_t> data;
+    blocks.reserve(blocks_.size());
+    data.reserve(data_.size());
+    size_t removed = 0;
+    auto next = ordinals.begin();
+    const auto is_removed = [&](DocumentOrdinal ordinal) {
+        next = lower_bound(next, ordinals.end(), ordinal);
+        return next != ordinals.end() && *next == ordinal;
+    };
+    vector<Posting> kept;
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        const Block& block = blocks_[i];
+        next = lower_bound(next, ordinals.end(), block.first_ordinal);
+        if (next == ordinals.end() || *next > block.last_ordinal) {
+            const uint32_t end = i + 1 < blocks_.size() ? blocks_[i + 1].offset : static_cast<uint32_t>(data_.size());
+            blocks.push_back(block);
+            blocks.back().offset = static_cast<uint32_t>(data.size());
+            data.insert(data.end(), data_.data() + block.offset, data_.data() + end);
+            continue;
+        }
+        kept.clear();
+        DecodeBlock(block, data_, [&](const Posting& posting) {
+            if (is_removed(posting.ordinal)) {
+                ++removed;
+            } else {
+                kept.push_back(posting);
+            }
+        });
+        EncodeBlocks(kept, blocks, data);
+    }
+    const auto tail_end = remove_if(tail_.begin(), tail_.end(), [&](const Posting& posting) {
+        return is_removed(posting.ordinal);
+    });
+    removed += tail_.end() - tail_end;
+    tail_.erase(tail_end, tail_.end());
+
+    blocks_ = move(blocks);
+    data_ = move(data);
+    document_freq_ -= removed;
+    return removed;
+}
+
+bool PostingList::Contains(DocumentOrdinal ordinal) const {
+    const size_t block_index = FindBlock(ordinal);
+    if (block_index == blocks_.size()) {
+        const auto it = lower_bound(tail_.begin(), tail_.end(), ordinal, OrdinalLess);
+        return it != tail_.end() && it->ordinal == ordinal;
+    }
+    const Block& block = blocks_[block_index];
+    if (block.first_ordinal > ordinal) {
+        return false;
+    }
+    bool found = false;
+    DecodeBlock(block, data_, [&](const Posting& posting) {
+        found = found || posting.ordinal == ordinal;
+    });
+    return found;
+}
+
+void PostingList::Seal() {
+    EncodeTail();
+    tail_ = {};
+}
+
+bool PostingList::IsSealed() const {
+    return tail_.empty();
+}
+
+void PostingList::ShrinkToFit() {
+    blocks_.ShrinkToFit();
+    data_.ShrinkToFit();
+    tail_.shrink_to_fit();
+}
+
+void PostingList::EncodeTail() {
+    if (tail_.empty()) {
+        return;
+    }
+    auto& blocks = blocks_.Mutable();
+    auto& data = data_.Mutable();
+    // a short last block is encoded again with the tail, so sealing after every batch does
+    // not leave a trail of small blocks with a header each
+    if (!blocks.empty() && blocks.back().size < BLOCK_SIZE) {
+        vector<Posting> postings = DecodeBlock(blocks.size() - 1);
+        postings.insert(postings.end(), tail_.begin(), tail_.end());
+        tail_ = move(postings);
+        data.resize(blocks.back().offset);
+        blocks.pop_back();
+    }
+    const size_t first_block = blocks.size();
+    const auto base = static_cast<uint32_t>(data.size());
+    vector<uint8_t> encoded;
+    EncodeBlocks(tail_, blocks, encoded);
+    for (size_t i = first_block; i < blocks.size(); ++i) {
+        blocks[i].offset += base;
+    }
+    data.insert(data.end(), encoded.begin(), encoded.end());
+    tail_.clear();
+}
+
+PostingList PostingList::Renumbered(const vector<DocumentOrdinal>& new_ordinals) const {
+    vector<Posting> postings;
+    postings.reserve(document_freq_);
+    for (const Block& block : blocks_) {
+        DecodeBlock(block, data_, [&](const Posting& posting) {
+            postings.push_back({new_ordinals[posting.ordinal], posting.term_count, posting.document_length});
+        });
+    }
+    for (const Posting& posting : tail_) {
+        postings.push_back({new_ordinals[posting.ordinal], posting.term_count, posting.document_length});
+    }
+
+    PostingList result;
+    vector<Block> blocks;
+    vector<uint8_t> data;
+    EncodeBlocks(postings, blocks, data);
+    result.blocks_ = move(blocks);
+    result.data_ = move(data);
+    result.document_freq_ = postings.size();
+    return result;
+}
+
+const MappedArray<PostingList::Block>& PostingList::GetBlocks() const {
+    return blocks_;
+}
+
+const MappedArray<uint8_t>& PostingList::GetData() const {
+    return data_;
+}
+
+size_t PostingList::GetDocumentFreq() const {
+    return document_freq_;
+}
+
+bool PostingList::IsEmpty() const {
+    return document_freq_ == 0;
+}
+
+size_t PostingList::GetMemoryUsage() const {
+    return blocks_.GetMemoryUsage() + data_.GetMemoryUsage() + tail_.capacity() * sizeof(Posting);
+}
+
+double PostingList::GetMaxTermFreq() const {
+    double max_term_freq = ComputeTailMaxTermFreq();
+    for (const Block& block : blocks_) {
+        max_term_freq = max(max_term_freq, block.max_term_freq);
+    }
+    return max_term_freq;
+}
+
+vector<PostingList::Posting> PostingList::DecodeBlock(size_t index) const {
+    vector<Posting> postings;
+    postings.reserve(blocks_[index].size + 1);
+    DecodeBlock(blocks_[index], data_, [&](const Posting& posting) {
+        postings.push_back(posting);
+    });
+    return postings;
+}
+
+void PostingList::EncodeBlocks(const vector<Posting>& postings, vector<Block>& blocks, vector<uint8_t>& data) {
+    // split evenly, so rewriting a block that grew by one posting does not leave a tiny block behind
+    const size_t block_count = (postings.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for (size_t block = 0; block < block_count; ++block) {
+        const size_t first = postings.size() * block / block_count;
+        const size_t last = postings.size() * (block + 1) / block_count;
+        Block header{postings[first].ordinal, postings[last - 1].ordinal, static_cast<uint32_t>(last - first),
+                     static_cast<uint32_t>(data.size()), 0.0};
+        for (size_t i = first; i < last; ++i) {
+            if (i > first) {
+                WriteVarint(postings[i].ordinal - postings[i - 1].ordinal, data);
+            }
+            WriteVarint(postings[i].term_count, data);
+            WriteVarint(postings[i].document_length, data);
+            header.max_term_freq = max(header.max_term_freq,
+                                       ComputeTermFreq(postings[i].term_count, postings[i].document_length));
+        }
+        blocks.push_back(header);
+    }
+}
+
+void PostingList::RewriteBlock(size_t index, const vector<Posting>& postings) {
+    auto& blocks = blocks_.Mutable();
+    auto& data = data_.Mutable();
+    const uint32_t begin = blocks[index].offset;
+    const uint32_t end = index + 1 < blocks.size() ? blocks[index + 1].offset : static_cast<uint32_t>(data.size());
+
+    vector<Block> new_blocks;
+    vector<uint8_t> encoded;
+    EncodeBlocks(postings, new_blocks, encoded);
+    for (Block& block : new_blocks) {
+        block.offset += begin;
+    }
+    const auto shift = static_cast<int64_t>(encoded.size()) - static_cast<int64_t>(end - begin);
+    for (size_t i = index + 1; i < blocks.size(); ++i) {
+        blocks[i].offset = static_cast<uint32_t>(blocks[i].offset + shift);
+    }
+
+    data.erase(data.begin() + begin, data.begin() + end);
+    data.insert(data.begin() + begin, encoded.begin(), encoded.end());
+    blocks.erase(blocks.begin() + index);
+    blocks.insert(blocks.begin() + index, new_blocks.begin(), new_blocks.end());
+}
+
+size_t PostingList::FindBlock(DocumentOrdinal ordinal) const {
+    return lower_bound(blocks_.begin(), blocks_.end(), ordinal,
+                       [](const Block& block, DocumentOrdinal value) { return block.last_ordinal < value; })
+           - blocks_.begin();
+}
+
+double PostingList::ComputeTailMaxTermFreq() const {
+    double max_term_freq = 0.0;
+    for (const Posting& posting : tail_) {
+        max_term_freq = max(max_term_freq, ComputeTermFreq(posting.term_count, posting.document_length));
+    }
+    return max_term_freq;
+}
+
+PostingList::Cursor::Cursor(const PostingList& postings)
+    : postings_(&postings)
+    , tail_max_term_freq_(postings.ComputeTailMaxTermFreq()) {
+}
+
+void PostingList::Cursor::Advance(DocumentOrdinal target) {
+    if (is_decoded_ && current_ != end_ && current_->ordinal >= target) {
+        return;
+    }
+    SeekBlock(target);
+    if (!is_decoded_) {
+        DecodeCurrentBlock();
+    }
+    current_ = lower_bound(current_, end_, target, OrdinalLess);
+}
+
+double PostingList::Cursor::GetBlockMaxTermFreq(DocumentOrdinal target) {
+    SeekBlock(target);
+    const auto& blocks = postings_->blocks_;
+    return block_ < blocks.size() ? blocks[block_].max_term_freq : tail_max_term_freq_;
+}
+
+void PostingList::Cursor::SeekBlock(DocumentOrdinal target) {
+    const auto& blocks = postings_->blocks_;
+    if (block_ == blocks.size() || blocks[block_].last_ordinal >= target) {
+        return;
+    }
+    block_ = lower_bound(blocks.begin() + block_, blocks.end(), target,
+                         [](const Block& block, DocumentOrdinal ordinal) { return block.last_ordinal < ordinal; })
+             - blocks.begin();
+    is_decoded_ = false;
+}
+
+void PostingList::Cursor::DecodeCurrentBlock() {
+    const auto& blocks = postings_->blocks_;
+    if (block_ < blocks.size()) {
+        buffer_.resize(blocks[block_].size);
+        Posting* output = buffer_.data();
+        DecodeBlock(blocks[block_], postings_->data_, [&output](const Posting& posting) {
+            *output++ = posting;
+        });
+        buffer_.resize(output - buffer_.data());
+        current_ = buffer_.data();
+        end_ = buffer_.data() + buffer_.size();
+    } else {
+        current_ = postings_->tail_.data();
+        end_ = postings_->tail_.data() + postings_->tail_.size();
+    }
+    is_decoded_ = true;
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "document.h"
+#include "mapped_array.h"
+
+// Postings of a single term sorted by document ordinal, compressed in blocks of up to
+// BLOCK_SIZE postings. Inside a block every posting is three varints: the ordinal delta
+// from the previous posting (omitted for the first one), the number of occurrences of
+// the term and the word count of the document, so the term frequency is kept exactly
+// in a few bytes instead of a double. Every block has an uncompressed header for skipping,
+// and postings appended after the last full block stay uncompressed until it fills up or
+// the list is sealed.
+class PostingList {
+public:
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    struct Block {
+        DocumentOrdinal first_ordinal;
+        DocumentOrdinal last_ordinal;
+        uint32_t size;
+        // of the encoded postings in the list's data
+        uint32_t offset;
+        // highest term frequency in the block
+        double max_term_freq;
+    };
+
+    struct Posting {
+        DocumentOrdinal ordinal;
+        uint32_t term_count;
+        uint32_t document_length;
+    };
+
+    class Cursor;
+
+    PostingList() = default;
+
+    // Serves sealed blocks from memory owned by the caller until the list is modified
+    static PostingList View(const Block* blocks, size_t block_count, const uint8_t* data, size_t data_size);
+
+    // Appends in O(1) when ordinals arrive in ascending order; otherwise the affected
+    // block is decoded and encoded again. Adding to an existing posting adds the counts.
+    void Add(DocumentOrdinal ordinal, uint32_t term_count, uint32_t document_length);
+
+    // Makes room for `additional` postings before a run of Add calls; the spare capacity
+    // stays until ShrinkToFit
+    void Reserve(size_t additional);
+
+    // Returns false when the document has no posting in the list
+    bool Remove(DocumentOrdinal ordinal);
+
+    // Removes the postings of the sorted ordinals in one pass: blocks without any of them
+    // are copied as they are, the others encoded again. Returns the number removed.
+    size_t Remove(const std::vector<DocumentOrdinal>& ordinals);
+
+    bool Contains(DocumentOrdinal ordinal) const;
+
+    // Encodes the uncompressed tail together with a last block that is not full, so all
+    // postings are in GetBlocks() and GetData(), and frees the tail's storage
+    void Seal();
+
+    bool IsSealed() const;
+
+    // Gives back the spare capacity left by Reserve and by rewritten blocks
+    void ShrinkToFit();
+
+    // A sealed copy with every ordinal replaced by new_ordinals[ordinal]; the mapping
+    // must preserve the order of the ordinals in the list
+    PostingList Renumbered(const std::vector<DocumentOrdinal>& new_ordinals) const;
+
+    const MappedArray<Block>& GetBlocks() const;
+    const MappedArray<uint8_t>& GetData() const;
+
+    size_t GetDocumentFreq() const;
+
+    bool IsEmpty() const;
+
+    // Allocated heap bytes, spare capacity included
+    size_t GetMemoryUsage() const;
+
+    // Upper bound of the term frequencies of all postings
+    double GetMaxTermFreq() const;
+
+    // Calls function(ordinal, term_freq) in ordinal order
+    template <typename Function>
+    void ForEach(Function function) const;
+
+    // Calls function(posting) in ordinal order, with the counts the term frequency comes from
+    template <typename Function>
+    void ForEachPosting(Function function) const;
+
+    // Visits only the postings with ordinals in [first, last), decoding only the
+    // blocks that overlap the range
+    template <typename Function>
+    void ForEachInRange(DocumentOrdinal first, DocumentOrdinal last, Function function) const;
+
+private:
+    MappedArray<Block> blocks_;
+    MappedArray<uint8_t> data_;
+    // postings after the last block, fewer than BLOCK_SIZE
+    std::vector<Posting> tail_;
+    size_t document_freq_ = 0;
+
+    // Returns false for a varint running past end or longer than five bytes
+    static bool ReadVarint(const uint8_t*& data, const uint8_t* end, uint32_t& value);
+
+    static double ComputeTermFreq(uint32_t term_count, uint32_t document_length);
+
+    // Stops at a posting that does not fit the block: only a corrupted snapshot has one,
+    // since loading checks the block headers but does not decode the postings
+    template <typename Function>
+    static void DecodeBlock(const Block& block, const MappedArray<uint8_t>& data, Function function);
+
+    std::vector<Posting> DecodeBlock(size_t index) const;
+
+    // Appends encoded blocks of `postings` to the given arrays, with offsets relative to data
+    static void EncodeBlocks(const std::vector<Posting>& postings, std::vector<Block>& blocks,
+                             std::vector<uint8_t>& data);
+
+    // Replaces block `index` with the blocks encoding `postings`, none if it is empty
+    void RewriteBlock(size_t index, const std::vector<Posting>& postings);
+
+    // Encodes the tail, keeping its capacity for the next postings
+    void EncodeTail();
+
+    // Index of the first block whose last ordinal is not below `ordinal`
+    size_t FindBlock(DocumentOrdinal ordinal) const;
+
+    double ComputeTailMaxTermFreq() const;
+};
+
+// Walks the postings in ordinal order for document-at-a-time evaluation. Blocks are
+// skipped by their headers and decoded only when a posting in them is needed.
+class PostingList::Cursor {
+public:
+    static constexpr DocumentOrdinal END = UINT32_MAX;
+
+    explicit Cursor(const PostingList& postings);
+
+    // Ordinal of the current posting, END once the postings are exhausted.
+    // There is no current posting until the first Advance.
+    DocumentOrdinal GetOrdinal() const;
+
+    double GetTermFreq() const;
+
+    // Moves to the first posting with an ordinal not below target; never moves back
+    void Advance(DocumentOrdinal target);
+
+    // Moves past the current posting
+    void Next();
+
+    // Upper bound of the term frequency of a posting with the target ordinal, read from
+    // the header of the block that may hold it. Moves to that block without decoding it.
+    double GetBlockMaxTermFreq(DocumentOrdinal target);
+
+private:
+    const PostingList* postings_;
+    // postings_->blocks_.size() stands for the tail
+    size_t block_ = 0;
+    bool is_decoded_ = false;
+    std::vector<Posting> buffer_;
+    const Posting* current_ = nullptr;
+    const Posting* end_ = nullptr;
+    double tail_max_term_freq_ = 0.0;
+
+    // Moves to the first block that may hold the target without decoding it
+    void SeekBlock(DocumentOrdinal target);
+
+    void DecodeCurrentBlock();
+};
+
+inline DocumentOrdinal PostingList::Cursor::GetOrdinal() const {
+    return current_ == end_ ? END : current_->ordinal;
+}
+
+inline double PostingList::Cursor::GetTermFreq() const {
+    return ComputeTermFreq(current_->term_count, current_->document_length);
+}
+
+inline void PostingList::Cursor::Next() {
+    if (++current_ == end_ && block_ < postings_->blocks_.size()) {
+        ++block_;
+        DecodeCurrentBlock();
+    }
+}
+
+inline bool PostingList::ReadVarint(const uint8_t*& data, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && data != end; shift += 7) {
+        const uint8_t byte = *data++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline double PostingList::ComputeTermFreq(uint32_t term_count, uint32_t document_length) {
+    return static_cast<double>(term_count) / document_length;
+}
+
+template <typename Function>
+void PostingList::DecodeBlock(const Block& block, const MappedArray<uint8_t>& data, Function function) {
+    const uint8_t* position = data.data() + block.offset;
+    const uint8_t* const end = data.data() + data.size();
+    DocumentOrdinal ordinal = block.first_ordinal;
+    for (uint32_t i = 0; i < block.size; ++i) {
+        uint32_t delta = 0;
+        uint32_t term_count = 0;
+        uint32_t document_length = 0;
+        if ((i > 0 && !ReadVarint(position, end, delta)) || !ReadVarint(position, end, term_count)
+            || !ReadVarint(position, end, document_length) || delta > block.last_ordinal - ordinal
+            || document_length == 0) {
+            return;
+        }
+        ordinal += delta;
+        function(Posting{ordinal, term_count, document_length});
+    }
+}
+
+template <typename Function>
+void PostingList::ForEach(Function function) const {
+    ForEachPosting([&function](const Posting& posting) {
+        function(posting.ordinal, ComputeTermFreq(posting.term_count, posting.document_length));
+    });
+}
+
+template <typename Function>
+void PostingList::ForEachPosting(Function function) const {
+    for (const Block& block : blocks_) {
+        DecodeBlock(block, data_, [&function](const Posting& posting) {
+            function(posting);
+        });
+    }
+    for (const Posting& posting : tail_) {
+        function(posting);
+    }
+}
+
+template <typename Function>
+void PostingList::ForEachInRange(DocumentOrdinal first, DocumentOrdinal last, Function function) const {
+    for (size_t i = FindBlock(first); i < blocks_.size() && blocks_[i].first_ordinal < last; ++i) {
+        DecodeBlock(blocks_[i], data_, [&](const Posting& posting) {
+            if (posting.ordinal >= first && posting.ordinal < last) {
+                function(posting.ordinal, ComputeTermFreq(posting.term_count, posting.document_length));
+            }
+        });
+    }
+    auto it = std::lower_bound(tail_.begin(), tail_.end(), first,
+                               [](const Posting& posting, DocumentOrdinal ordinal) { return posting.ordinal < ordinal; });
+    for (; it != tail_.end() && it->ordinal < last; ++it) {
+        function(it->ordinal, ComputeTermFreq(it->term_count, it->document_length));
+    }
+}
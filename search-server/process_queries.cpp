@@ -1,6 +1,15 @@
 #include "process_queries.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <iterator>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+
+#include "parallel_for.h"
 
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries) {
     std::vector<std::vector<Document>> res(queries.size());
@@ -10,6 +19,19 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
     return res;
 }
 
+std::vector<std::vector<Document>> ProcessQueriesBatched(const SearchServer& search_server,
+                                                         const std::vector<std::string>& queries, size_t batch_size) {
+    std::vector<std::vector<Document>> res(queries.size());
+    batch_size = std::max<size_t>(1, batch_size);
+    ParallelForSlices(queries.size(), (queries.size() + batch_size - 1) / batch_size, [&](size_t, size_t first, size_t last) {
+        std::vector<std::vector<Document>> batch = search_server.FindTopDocumentsBatch(
+            std::vector<std::string_view>(queries.begin() + first, queries.begin() + last));
+        std::move(batch.begin(), batch.end(), res.begin() + first);
+    });
+
+    return res;
+}
+
 // std::list<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
     
 //     std::vector<std::vector<Document>> documents = ProcessQueries(search_server, queries);
@@ -24,19 +46,200 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
 
 
 std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
-    
-    std::vector<std::vector<Document>> documents = ProcessQueries(search_server, queries);
 
-    size_t size = std::transform_reduce(documents.begin(), documents.end(), 0, std::plus<>{},
-                                        [](const std::vector<Document>& v) { return v.size(); });
+    std::vector<Document> result;
 
-    std::vector<Document> result(size);
+    ProcessQueryStream(search_server, queries.begin(), queries.end(), [&result](QueryStreamResult&& query_result) {
+        if (query_result.outcome == QueryOutcome::INVALID_QUERY) {
+            throw std::invalid_argument("query " + std::to_string(query_result.index) + " is invalid");
+        }
+        result.insert(result.end(), query_result.documents.begin(), query_result.documents.end());
+    });
 
-    auto it_begin = result.begin();
-    for (auto& doc: documents) {
-        it_begin = transform(std::execution::par, std::make_move_iterator(doc.begin()), std::make_move_iterator(doc.end()), 
-                             it_begin, [](const Document& value) { return value;});
+    return result;
+}
+
+namespace {
+
+// State shared by the calling thread and the threads running queries. A query occupies a
+// slot from the moment it is read until its result is delivered, so there are never more
+// queries in flight than slots.
+class QueryStream {
+public:
+    QueryStream(const SearchServer& search_server, const QueryStreamOptions& options)
+        : search_server_(search_server)
+        , options_(options)
+        , slots_(std::max<size_t>(1, options.max_in_flight))
+        , free_slots_(slots_.size()) {
+        std::iota(free_slots_.rbegin(), free_slots_.rend(), 0);
+        try {
+            for (size_t i = 0; i < std::max<size_t>(1, options.thread_count); ++i) {
+                threads_.emplace_back([this] { RunQueries(); });
+            }
+        } catch (...) {
+            Stop();
+            throw;
+        }
     }
 
-    return result;
-}
\ No newline at end of file
+    ~QueryStream() {
+        Stop();
+    }
+
+    size_t Run(const std::function<bool(std::string& query)>& next_query,
+               const std::function<void(QueryStreamResult&& result)>& deliver) {
+        std::unique_lock lock(mutex_);
+        size_t read_count = 0;
+        size_t delivered_count = 0;
+        bool is_exhausted = false;
+        while (true) {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            if (std::optional<size_t> slot = TakeReadySlot()) {
+                QueryStreamResult result = std::move(slots_[*slot].result);
+                free_slots_.push_back(*slot);
+                ++delivered_count;
+                lock.unlock();
+                deliver(std::move(result));
+                lock.lock();
+                continue;
+            }
+            if (!is_exhausted && !free_slots_.empty()) {
+                const size_t slot = free_slots_.back();
+                free_slots_.pop_back();
+                // the slot belongs to this thread until it is queued
+                lock.unlock();
+                const bool has_query = next_query(slots_[slot].query);
+                lock.lock();
+                if (!has_query) {
+                    is_exhausted = true;
+                    free_slots_.push_back(slot);
+                    continue;
+                }
+                slots_[slot].result.index = read_count++;
+                slots_[slot].is_done = false;
+                pending_slots_.push_back(slot);
+                if (options_.ordered) {
+                    read_order_.push_back(slot);
+                }
+                work_ready_.notify_one();
+                continue;
+            }
+            if (is_exhausted && delivered_count == read_count) {
+                return read_count;
+            }
+            result_ready_.wait(lock);
+        }
+    }
+
+private:
+    struct Slot {
+        // keeps its capacity from one query to the next
+        std::string query;
+        QueryStreamResult result;
+        bool is_done = false;
+    };
+
+    const SearchServer& search_server_;
+    const QueryStreamOptions options_;
+    std::vector<Slot> slots_;
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable result_ready_;
+    std::vector<size_t> free_slots_;
+    // read and waiting for a thread
+    std::deque<size_t> pending_slots_;
+    // in flight in stream order, while delivery is ordered
+    std::deque<size_t> read_order_;
+    // done and not delivered, in completion order, while delivery is not ordered
+    std::deque<size_t> done_slots_;
+    std::exception_ptr error_;
+    bool is_stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    // Must be called with mutex_ locked
+    std::optional<size_t> TakeReadySlot() {
+        std::deque<size_t>& slots = options_.ordered ? read_order_ : done_slots_;
+        if (slots.empty() || !slots_[slots.front()].is_done) {
+            return std::nullopt;
+        }
+        const size_t slot = slots.front();
+        slots.pop_front();
+        return slot;
+    }
+
+    void RunQueries() {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            work_ready_.wait(lock, [this] { return is_stopping_ || !pending_slots_.empty(); });
+            if (is_stopping_) {
+                return;
+            }
+            Slot& slot = slots_[pending_slots_.front()];
+            pending_slots_.pop_front();
+            lock.unlock();
+            try {
+                RunQuery(slot);
+            } catch (...) {
+                lock.lock();
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                result_ready_.notify_one();
+                continue;
+            }
+            lock.lock();
+            slot.is_done = true;
+            if (!options_.ordered) {
+                done_slots_.push_back(&slot - slots_.data());
+            }
+            result_ready_.notify_one();
+        }
+    }
+
+    void RunQuery(Slot& slot) const {
+        const QueryDeadline deadline = options_.query_budget > std::chrono::steady_clock::duration::zero()
+            ? QueryDeadline::After(options_.query_budget)
+            : QueryDeadline();
+        slot.result.documents.clear();
+        try {
+            slot.result.documents = search_server_.FindTopDocuments(slot.query, options_.status, deadline);
+            slot.result.outcome = QueryOutcome::OK;
+        } catch (const QueryDeadlineExceeded&) {
+            slot.result.outcome = QueryOutcome::DEADLINE_EXCEEDED;
+        } catch (const std::invalid_argument&) {
+            slot.result.outcome = QueryOutcome::INVALID_QUERY;
+        }
+    }
+
+    void Stop() {
+        {
+            std::lock_guard guard(mutex_);
+            is_stopping_ = true;
+        }
+        work_ready_.notify_all();
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+        threads_.clear();
+    }
+};
+
+} // namespace
+
+size_t ProcessQueryStream(const SearchServer& search_server,
+                          const std::function<bool(std::string& query)>& next_query,
+                          const std::function<void(QueryStreamResult&& result)>& deliver,
+                          const QueryStreamOptions& options) {
+    QueryStream stream(search_server, options);
+    return stream.Run(next_query, deliver);
+}
+
+size_t ProcessQueryStream(const SearchServer& search_server, std::istream& input,
+                          const std::function<void(QueryStreamResult&& result)>& deliver,
+                          const QueryStreamOptions& options) {
+    return ProcessQueryStream(search_server, [&input](std::string& query) {
+        return static_cast<bool>(std::getline(input, query));
+    }, deliver, options);
+}
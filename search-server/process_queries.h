@@ -3,13 +3,80 @@
 #include "search_server.h"
 
 #include <algorithm>
+#include <chrono>
 #include <execution>
+#include <functional>
+#include <istream>
 #include <list>
 #include <string>
+#include <thread>
 #include <vector>
 
-std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, 
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
                                                   const std::vector<std::string>& queries);
 
+const size_t DEFAULT_QUERY_BATCH_SIZE = 256;
+
+// Same results as ProcessQueries except among documents tied on relevance and rating, whose
+// order and cut are unspecified. Batches of batch_size queries run in parallel through
+// SearchServer::FindTopDocumentsBatch, which walks each posting list once per batch.
+std::vector<std::vector<Document>> ProcessQueriesBatched(const SearchServer& search_server,
+                                                         const std::vector<std::string>& queries,
+                                                         size_t batch_size = DEFAULT_QUERY_BATCH_SIZE);
+
+// Joins the results as they are delivered by ProcessQueryStream, without keeping them per query
 std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server,
-                                                   const std::vector<std::string>& queries);
\ No newline at end of file
+                                                   const std::vector<std::string>& queries);
+
+enum class QueryOutcome {
+    OK,
+    DEADLINE_EXCEEDED,
+    INVALID_QUERY,
+};
+
+struct QueryStreamResult {
+    // position of the query in the stream
+    size_t index = 0;
+    QueryOutcome outcome = QueryOutcome::OK;
+    // empty unless the outcome is OK
+    std::vector<Document> documents;
+};
+
+struct QueryStreamOptions {
+    // threads running queries besides the calling thread, which reads and delivers
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    // queries read but not delivered yet, which bounds the memory held by the stream
+    size_t max_in_flight = 1024;
+    // delivers results in stream order; otherwise as soon as they are ready
+    bool ordered = true;
+    // time a query may spend from the moment a thread picks it up; zero for no limit
+    std::chrono::steady_clock::duration query_budget = std::chrono::steady_clock::duration::zero();
+    DocumentStatus status = DocumentStatus::ACTUAL;
+};
+
+// Runs every query next_query provides, until it returns false, and passes each result to
+// deliver as soon as ordering allows. Both callbacks run on the calling thread only.
+// Returns how many queries were processed.
+size_t ProcessQueryStream(const SearchServer& search_server,
+                          const std::function<bool(std::string& query)>& next_query,
+                          const std::function<void(QueryStreamResult&& result)>& deliver,
+                          const QueryStreamOptions& options = {});
+
+// One query per line
+size_t ProcessQueryStream(const SearchServer& search_server, std::istream& input,
+                          const std::function<void(QueryStreamResult&& result)>& deliver,
+                          const QueryStreamOptions& options = {});
+
+template <typename InputIterator>
+size_t ProcessQueryStream(const SearchServer& search_server, InputIterator first, InputIterator last,
+                          const std::function<void(QueryStreamResult&& result)>& deliver,
+                          const QueryStreamOptions& options = {}) {
+    return ProcessQueryStream(search_server, [&first, &last](std::string& query) {
+        if (first == last) {
+            return false;
+        }
+        query = *first;
+        ++first;
+        return true;
+    }, deliver, options);
+}
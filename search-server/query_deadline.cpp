@@ -0,0 +1,25 @@
+#include "query_deadline.h"
+
+using namespace std;
+
+QueryDeadlineExceeded::QueryDeadlineExceeded()
+    : runtime_error("query deadline exceeded") {
+}
+
+QueryDeadline::QueryDeadline(Clock::time_point time)
+    : time_(time) {
+}
+
+QueryDeadline QueryDeadline::After(Clock::duration budget) {
+    return QueryDeadline(Clock::now() + budget);
+}
+
+bool QueryDeadline::IsSet() const {
+    return time_ != Clock::time_point::max();
+}
+
+void QueryDeadline::CheckClock() const {
+    if (IsSet() && Clock::now() >= time_) {
+        throw QueryDeadlineExceeded();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+
+// Thrown by scoring that runs past its QueryDeadline
+class QueryDeadlineExceeded : public std::runtime_error {
+public:
+    QueryDeadlineExceeded();
+};
+
+// Point in time after which a query gives up. Check() is meant for posting loops and
+// reads the clock only once every CHECK_INTERVAL calls; a default deadline never passes
+// and never reads it. Not shared between threads: every range scored gets its own copy.
+class QueryDeadline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t CHECK_INTERVAL = 1024;
+
+    QueryDeadline() = default;
+    explicit QueryDeadline(Clock::time_point time);
+
+    // Deadline budget from now
+    static QueryDeadline After(Clock::duration budget);
+
+    bool IsSet() const;
+
+    // Throws QueryDeadlineExceeded once the deadline has passed
+    void Check() {
+        if (--countdown_ == 0) {
+            countdown_ = CHECK_INTERVAL;
+            CheckClock();
+        }
+    }
+
+private:
+    Clock::time_point time_ = Clock::time_point::max();
+    uint32_t countdown_ = CHECK_INTERVAL;
+
+    void CheckClock() const;
+};
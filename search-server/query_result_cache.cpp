@@ -0,0 +1,91 @@
+#include "query_result_cache.h"
+
+using namespace std;
+
+bool QueryResultCache::Key::operator==(const Key& other) const {
+    return status == other.status && plus_terms == other.plus_terms && minus_terms == other.minus_terms;
+}
+
+size_t QueryResultCache::KeyHash::operator()(const Key& key) const {
+    size_t hash = static_cast<size_t>(key.status);
+    const auto combine = [&hash](size_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+    };
+    for (const TermId term : key.plus_terms) {
+        combine(term);
+    }
+    // keeps "a -b" and "a b" apart
+    combine(key.plus_terms.size());
+    for (const TermId term : key.minus_terms) {
+        combine(term);
+    }
+    return hash;
+}
+
+QueryResultCache::QueryResultCache(size_t capacity)
+    : capacity_(capacity) {
+}
+
+QueryResultCache::QueryResultCache(const QueryResultCache& other)
+    : capacity_(other.capacity_) {
+}
+
+QueryResultCache& QueryResultCache::operator=(const QueryResultCache& other) {
+    if (this != &other) {
+        lock_guard guard(mutex_);
+        capacity_ = other.capacity_;
+        entries_.clear();
+        index_.clear();
+    }
+    return *this;
+}
+
+optional<vector<Document>> QueryResultCache::Find(const Key& key) {
+    lock_guard guard(mutex_);
+    const auto it = index_.find(key);
+    if (it == index_.end() || it->second->epoch != epoch_) {
+        ++misses_;
+        return nullopt;
+    }
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->documents;
+}
+
+void QueryResultCache::Insert(Key key, vector<Document> documents) {
+    lock_guard guard(mutex_);
+    if (capacity_ == 0) {
+        return;
+    }
+    if (const auto it = index_.find(key); it != index_.end()) {
+        it->second->documents = move(documents);
+        it->second->epoch = epoch_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+    entries_.push_front({move(key), move(documents), epoch_});
+    index_.emplace(entries_.front().key, entries_.begin());
+    EvictOverflow();
+}
+
+void QueryResultCache::Invalidate() {
+    lock_guard guard(mutex_);
+    ++epoch_;
+}
+
+void QueryResultCache::SetCapacity(size_t capacity) {
+    lock_guard guard(mutex_);
+    capacity_ = capacity;
+    EvictOverflow();
+}
+
+QueryCacheStats QueryResultCache::GetStats() const {
+    return {hits_.load(), misses_.load()};
+}
+
+void QueryResultCache::EvictOverflow() {
+    while (entries_.size() > capacity_) {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "term_dictionary.h"
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+// Bounded LRU cache of top documents keyed on a parsed query: its sorted, deduplicated
+// plus and minus terms and the requested status. Every change of the index starts a new
+// epoch; entries of older epochs are never returned and get replaced as they are met.
+// Safe to use from concurrent queries.
+class QueryResultCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    struct Key {
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+        DocumentStatus status;
+
+        bool operator==(const Key& other) const;
+    };
+
+    explicit QueryResultCache(size_t capacity = DEFAULT_CAPACITY);
+
+    // A copy starts empty with the same capacity
+    QueryResultCache(const QueryResultCache& other);
+    QueryResultCache& operator=(const QueryResultCache& other);
+
+    std::optional<std::vector<Document>> Find(const Key& key);
+
+    void Insert(Key key, std::vector<Document> documents);
+
+    void Invalidate();
+
+    // Zero disables the cache
+    void SetCapacity(size_t capacity);
+
+    QueryCacheStats GetStats() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Key key;
+        std::vector<Document> documents;
+        uint64_t epoch;
+    };
+
+    mutable std::mutex mutex_;
+    size_t capacity_;
+    uint64_t epoch_ = 0;
+    // most recently used first
+    std::list<Entry> entries_;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+
+    void EvictOverflow();
+};
@@ -0,0 +1,144 @@
+#include "query_service.h"
+
+#include <system_error>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+QueryRejected::QueryRejected(const string& reason)
+    : runtime_error(reason) {
+}
+
+QueryService::QueryService(const SearchServer& search_server, const QueryServiceOptions& options)
+    : search_server_(search_server)
+    , options_(options) {
+    try {
+        for (size_t i = 0; i < max<size_t>(1, options_.thread_count); ++i) {
+            workers_.emplace_back([this] { RunTasks(); });
+            if (options_.cpu_affinity.empty()) {
+                continue;
+            }
+#ifdef __linux__
+            const int cpu = options_.cpu_affinity[i % options_.cpu_affinity.size()];
+            if (cpu < 0 || cpu >= CPU_SETSIZE) {
+                throw invalid_argument("CPU number out of range");
+            }
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(cpu, &cpus);
+            if (const int error = pthread_setaffinity_np(workers_.back().native_handle(), sizeof(cpus), &cpus)) {
+                throw system_error(error, generic_category(), "pinning a query worker");
+            }
+#else
+            throw invalid_argument("CPU affinity is only supported on Linux");
+#endif
+        }
+    } catch (...) {
+        Stop();
+        throw;
+    }
+}
+
+QueryService::~QueryService() {
+    Stop();
+}
+
+future<vector<Document>> QueryService::FindTopDocumentsAsync(string raw_query) {
+    return FindTopDocumentsAsync(move(raw_query), DocumentStatus::ACTUAL);
+}
+
+future<vector<Document>> QueryService::FindTopDocumentsAsync(string raw_query, DocumentStatus status) {
+    return Submit([this, raw_query = move(raw_query), status] {
+        return search_server_.FindTopDocuments(raw_query, status);
+    });
+}
+
+future<vector<Document>> QueryService::FindTopDocumentsAsync(string raw_query, DocumentStatus status,
+                                                             QueryDeadline deadline) {
+    return Submit([this, raw_query = move(raw_query), status, deadline] {
+        return search_server_.FindTopDocuments(raw_query, status, deadline);
+    });
+}
+
+future<words_docstatus> QueryService::MatchDocumentAsync(string raw_query, int document_id) {
+    return Submit([this, raw_query = move(raw_query), document_id] {
+        return search_server_.MatchDocument(raw_query, document_id);
+    });
+}
+
+size_t QueryService::GetQueueDepth() const {
+    lock_guard guard(mutex_);
+    return queue_.size();
+}
+
+QueryServiceStats QueryService::GetStats() const {
+    lock_guard guard(mutex_);
+    return stats_;
+}
+
+void QueryService::Enqueue(Task task) {
+    unique_lock lock(mutex_);
+    if (is_stopping_) {
+        lock.unlock();
+        task.reject(make_exception_ptr(QueryRejected("query service stopped")));
+        return;
+    }
+    if (queue_.size() >= max<size_t>(1, options_.max_queue_depth)) {
+        if (options_.overflow == QueueOverflow::REJECT_NEW) {
+            ++stats_.rejected;
+            lock.unlock();
+            task.reject(make_exception_ptr(QueryRejected("query queue is full")));
+            return;
+        }
+        Task oldest = move(queue_.front());
+        queue_.pop_front();
+        queue_.push_back(move(task));
+        ++stats_.accepted;
+        ++stats_.shed;
+        lock.unlock();
+        // the number of queued tasks did not change, so no worker needs waking
+        oldest.reject(make_exception_ptr(QueryRejected("query shed from a full queue")));
+        return;
+    }
+    queue_.push_back(move(task));
+    ++stats_.accepted;
+    lock.unlock();
+    task_ready_.notify_one();
+}
+
+void QueryService::RunTasks() {
+    unique_lock lock(mutex_);
+    while (true) {
+        task_ready_.wait(lock, [this] { return is_stopping_ || !queue_.empty(); });
+        if (is_stopping_) {
+            return;
+        }
+        Task task = move(queue_.front());
+        queue_.pop_front();
+        lock.unlock();
+        task.run();
+        lock.lock();
+        ++stats_.completed;
+    }
+}
+
+void QueryService::Stop() {
+    deque<Task> queued;
+    {
+        lock_guard guard(mutex_);
+        is_stopping_ = true;
+        queued.swap(queue_);
+    }
+    task_ready_.notify_all();
+    for (Task& task : queued) {
+        task.reject(make_exception_ptr(QueryRejected("query service stopped")));
+    }
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+#include "query_deadline.h"
+#include "search_server.h"
+
+// What a QueryService does with a request that finds the queue full
+enum class QueueOverflow {
+    // fails the new request
+    REJECT_NEW,
+    // fails the request that has been queued longest and queues the new one
+    SHED_OLDEST,
+};
+
+struct QueryServiceOptions {
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    // worker i is pinned to cpu_affinity[i % size]; empty leaves the workers unpinned
+    std::vector<int> cpu_affinity;
+    // requests waiting for a worker
+    size_t max_queue_depth = 1024;
+    QueueOverflow overflow = QueueOverflow::REJECT_NEW;
+};
+
+struct QueryServiceStats {
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t shed = 0;
+    uint64_t completed = 0;
+};
+
+// Set on the future of a request that was rejected, shed or still queued when the
+// service stopped
+class QueryRejected : public std::runtime_error {
+public:
+    explicit QueryRejected(const std::string& reason);
+};
+
+// Runs queries against a SearchServer on a pool of worker threads it owns, so an
+// embedding process controls how many threads search and on which CPUs. Requests never
+// block the caller: they are queued up to max_queue_depth and their results, or the
+// exceptions queries throw, are delivered through futures. The server must outlive the
+// service and must not be modified while requests may run.
+class QueryService {
+public:
+    explicit QueryService(const SearchServer& search_server, const QueryServiceOptions& options = {});
+
+    // Fails the queued requests with QueryRejected and waits for the running ones
+    ~QueryService();
+
+    QueryService(const QueryService&) = delete;
+    QueryService& operator=(const QueryService&) = delete;
+
+    std::future<std::vector<Document>> FindTopDocumentsAsync(std::string raw_query);
+    std::future<std::vector<Document>> FindTopDocumentsAsync(std::string raw_query, DocumentStatus status);
+    // The deadline runs from the call, so time spent queued counts against it
+    std::future<std::vector<Document>> FindTopDocumentsAsync(std::string raw_query, DocumentStatus status,
+                                                             QueryDeadline deadline);
+
+    // The words view index-owned storage, as with SearchServer::MatchDocument
+    std::future<words_docstatus> MatchDocumentAsync(std::string raw_query, int document_id);
+
+    size_t GetQueueDepth() const;
+
+    QueryServiceStats GetStats() const;
+
+private:
+    struct Task {
+        std::function<void()> run;
+        std::function<void(std::exception_ptr error)> reject;
+    };
+
+    const SearchServer& search_server_;
+    const QueryServiceOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable task_ready_;
+    std::deque<Task> queue_;
+    QueryServiceStats stats_;
+    bool is_stopping_ = false;
+    std::vector<std::thread> workers_;
+
+    template <typename Function>
+    auto Submit(Function function) -> std::future<decltype(function())>;
+
+    // Queues the task or, when the queue is full or the service stops, rejects a task
+    void Enqueue(Task task);
+
+    void RunTasks();
+
+    void Stop();
+};
+
+template <typename Function>
+auto QueryService::Submit(Function function) -> std::future<decltype(function())> {
+    using Result = decltype(function());
+    // shared by whichever of run and reject is called
+    auto promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> future = promise->get_future();
+    Enqueue({
+        [promise, function = std::move(function)] {
+            try {
+                promise->set_value(function());
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        },
+        [promise](std::exception_ptr error) {
+            promise->set_exception(error);
+        },
+    });
+    return future;
+}
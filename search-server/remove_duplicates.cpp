@@ -1,22 +1,150 @@
 #include "remove_duplicates.h"
 #include "document.h"
+#include "document_fingerprint.h"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <numeric>
+#include <optional>
+#include <unordered_map>
 
 using namespace std;
 
-void RemoveDuplicates(SearchServer& search_server) {
-    map<set<string>, int> origin;
-    vector<int> to_delete;
-    for(auto id_: search_server) {
-        auto words = search_server.GetWordsById(id_);
-        if(origin.count(words)) {
-            to_delete.push_back(id_);
-            continue;
+namespace {
+
+// a document is compared with at most this many earlier documents of every band bucket,
+// which keeps buckets of very common bands from turning quadratic
+const size_t MAX_BUCKET_CANDIDATES = 16;
+// signatures agreeing on a share this far below the threshold are not worth confirming;
+// four standard deviations of the estimate with MINHASH_SIZE hash functions
+const double SIGNATURE_SIMILARITY_MARGIN = 0.25;
+
+// Rows per band: as many as keep the similarity at which a pair becomes a candidate with
+// probability 1/2, (rows / MINHASH_SIZE)^(1 / rows), well below the threshold
+size_t ChooseBandRows(double min_similarity) {
+    size_t rows = 1;
+    while (rows * 2 <= MINHASH_SIZE
+           && pow(static_cast<double>(rows * 2) / MINHASH_SIZE, 1.0 / (rows * 2)) <= 0.75 * min_similarity) {
+        rows *= 2;
+    }
+    return rows;
+}
+
+double ComputeJaccardSimilarity(const set<string_view>& lhs, const set<string_view>& rhs) {
+    size_t common = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (*lhs_it < *rhs_it) {
+            ++lhs_it;
+        } else if (*rhs_it < *lhs_it) {
+            ++rhs_it;
+        } else {
+            ++common;
+            ++lhs_it;
+            ++rhs_it;
         }
-        origin[words] = id_;
     }
+    const size_t united = lhs.size() + rhs.size() - common;
+    return united == 0 ? 1.0 : static_cast<double>(common) / united;
+}
 
-    for(int i: to_delete) {
-        cout << "Found duplicate document id " << i << endl;
-        search_server.RemoveDocument(i);
+} // namespace
+
+vector<int> FindDuplicates(const SearchServer& search_server) {
+    const vector<int> ids(search_server.begin(), search_server.end());
+    vector<uint64_t> fingerprints(ids.size());
+    transform(execution::par, ids.begin(), ids.end(), fingerprints.begin(),
+              [&search_server](int id) { return search_server.GetDocumentFingerprint(id); });
+
+    // first document of every distinct word set by fingerprint; more than one only on a collision
+    unordered_map<uint64_t, vector<int>> originals;
+    vector<int> duplicates;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        vector<int>& same_fingerprint = originals[fingerprints[i]];
+        if (!same_fingerprint.empty()) {
+            const auto words = search_server.GetWordsById(ids[i]);
+            if (any_of(same_fingerprint.begin(), same_fingerprint.end(),
+                       [&](int original) { return search_server.GetWordsById(original) == words; })) {
+                duplicates.push_back(ids[i]);
+                continue;
+            }
+        }
+        same_fingerprint.push_back(ids[i]);
+    }
+    return duplicates;
+}
+
+vector<NearDuplicate> FindNearDuplicates(const SearchServer& search_server, double min_similarity) {
+    const vector<int> ids(search_server.begin(), search_server.end());
+    vector<MinHashSignature> signatures(ids.size());
+    transform(execution::par, ids.begin(), ids.end(), signatures.begin(), [&search_server](int id) {
+        vector<uint64_t> word_hashes;
+        for (const string_view word : search_server.GetWordsById(id)) {
+            word_hashes.push_back(ComputeWordHash(word));
+        }
+        return ComputeMinHashSignature(word_hashes);
+    });
+
+    // documents are numbered by their position in ids, so earlier means a smaller id
+    const size_t rows = ChooseBandRows(min_similarity);
+    vector<vector<uint32_t>> candidates(ids.size());
+    for (size_t band = 0; band < MINHASH_SIZE / rows; ++band) {
+        unordered_map<uint64_t, vector<uint32_t>> buckets;
+        for (uint32_t document = 0; document < ids.size(); ++document) {
+            uint64_t band_hash = band;
+            for (size_t row = band * rows; row < (band + 1) * rows; ++row) {
+                band_hash = band_hash * 0x100000001b3 ^ signatures[document][row];
+            }
+            vector<uint32_t>& bucket = buckets[band_hash];
+            candidates[document].insert(candidates[document].end(), bucket.begin(), bucket.end());
+            if (bucket.size() < MAX_BUCKET_CANDIDATES) {
+                bucket.push_back(document);
+            }
+        }
+    }
+
+    vector<optional<NearDuplicate>> matches(ids.size());
+    vector<uint32_t> documents(ids.size());
+    iota(documents.begin(), documents.end(), 0);
+    for_each(execution::par, documents.begin(), documents.end(), [&](uint32_t document) {
+        vector<uint32_t>& document_candidates = candidates[document];
+        if (document_candidates.empty()) {
+            return;
+        }
+        sort(document_candidates.begin(), document_candidates.end());
+        document_candidates.erase(unique(document_candidates.begin(), document_candidates.end()),
+                                  document_candidates.end());
+        const auto words = search_server.GetWordsById(ids[document]);
+        for (const uint32_t candidate : document_candidates) {
+            size_t equal_rows = 0;
+            for (size_t row = 0; row < MINHASH_SIZE; ++row) {
+                equal_rows += signatures[document][row] == signatures[candidate][row];
+            }
+            if (static_cast<double>(equal_rows) / MINHASH_SIZE < min_similarity - SIGNATURE_SIMILARITY_MARGIN) {
+                continue;
+            }
+            const double similarity = ComputeJaccardSimilarity(words, search_server.GetWordsById(ids[candidate]));
+            if (similarity >= min_similarity) {
+                matches[document] = NearDuplicate{ids[document], ids[candidate], similarity};
+                return;
+            }
+        }
+    });
+
+    vector<NearDuplicate> result;
+    for (const auto& match : matches) {
+        if (match) {
+            result.push_back(*match);
+        }
+    }
+    return result;
+}
+
+void RemoveDuplicates(SearchServer& search_server) {
+    for (const int id : FindDuplicates(search_server)) {
+        cout << "Found duplicate document id " << id << endl;
+        search_server.RemoveDocument(id);
     }
-}
\ No newline at end of file
+}
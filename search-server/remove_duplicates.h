@@ -1,5 +1,25 @@
 #pragma once
 
+#include <vector>
+
 #include "search_server.h"
- 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+
+struct NearDuplicate {
+    int document_id;
+    // the smallest id among the similar candidates found for the document
+    int original_id;
+    // Jaccard similarity of their sets of words
+    double similarity;
+};
+
+// Ids of the documents with the same set of words as a document with a smaller id, ascending.
+// Documents are grouped by their fingerprints, so no word sets are copied but on a match.
+std::vector<int> FindDuplicates(const SearchServer& search_server);
+
+// Documents whose sets of words have a Jaccard similarity of at least min_similarity with a
+// document with a smaller id, by ascending id. Candidate pairs come from bands of MinHash
+// signatures and are confirmed on the word sets; a pair near the threshold is found with
+// high probability rather than certainly. Signatures are computed on all cores.
+std::vector<NearDuplicate> FindNearDuplicates(const SearchServer& search_server, double min_similarity);
+
+void RemoveDuplicates(SearchServer& search_server);
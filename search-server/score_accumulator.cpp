@@ -0,0 +1,28 @@
+#include "score_accumulator.h"
+
+using namespace std;
+
+void ScoreAccumulator::Reset(size_t document_count) {
+    for (const DocumentOrdinal ordinal : touched_) {
+        scores_[ordinal] = 0.0;
+        states_[ordinal] = State::UNSEEN;
+    }
+    touched_.clear();
+    if (scores_.size() < document_count) {
+        scores_.resize(document_count, 0.0);
+        states_.resize(document_count, State::UNSEEN);
+    }
+}
+
+void ScoreAccumulator::Exclude(DocumentOrdinal ordinal) {
+    State& state = states_[ordinal];
+    if (state == State::UNSEEN) {
+        touched_.push_back(ordinal);
+    }
+    state = State::EXCLUDED;
+}
+
+ScoreAccumulator& GetThreadScoreAccumulator() {
+    thread_local ScoreAccumulator accumulator;
+    return accumulator;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "document.h"
+
+// Dense relevance accumulator indexed by DocumentOrdinal.
+// Only the entries touched by a query are reset before the next one, so an
+// instance can be reused across queries without clearing the whole array.
+class ScoreAccumulator {
+public:
+    // Prepares for a query over ordinals in [0, document_count)
+    void Reset(size_t document_count);
+
+    // The filter runs once per document, on the first posting that reaches it
+    template <typename Filter>
+    void Add(DocumentOrdinal ordinal, double score, Filter filter);
+
+    void Exclude(DocumentOrdinal ordinal);
+
+    // Calls function(ordinal, relevance) for every accepted, non-excluded document
+    template <typename Function>
+    void ForEachScored(Function function) const;
+
+private:
+    enum class State : uint8_t {
+        UNSEEN,
+        ACCEPTED,
+        REJECTED,
+        EXCLUDED,
+    };
+
+    std::vector<double> scores_;
+    std::vector<State> states_;
+    std::vector<DocumentOrdinal> touched_;
+};
+
+// One accumulator per thread; must not be used by two queries at once on the same thread
+ScoreAccumulator& GetThreadScoreAccumulator();
+
+template <typename Filter>
+void ScoreAccumulator::Add(DocumentOrdinal ordinal, double score, Filter filter) {
+    State& state = states_[ordinal];
+    if (state == State::UNSEEN) {
+        touched_.push_back(ordinal);
+        state = filter(ordinal) ? State::ACCEPTED : State::REJECTED;
+    }
+    if (state == State::ACCEPTED) {
+        scores_[ordinal] += score;
+    }
+}
+
+template <typename Function>
+void ScoreAccumulator::ForEachScored(Function function) const {
+    for (const DocumentOrdinal ordinal : touched_) {
+        if (states_[ordinal] == State::ACCEPTED) {
+            function(ordinal, scores_[ordinal]);
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#include "search_coordinator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "search_protocol.h"
+#include "string_processing.h"
+#include "top_documents.h"
+
+using namespace std;
+
+namespace {
+
+// Checks the reply type, turning a worker's ERROR reply into an exception
+MessageReader ReadReply(const string& reply, MessageType expected_type) {
+    MessageReader reader(reply);
+    if (reader.GetType() == MessageType::ERROR) {
+        const auto kind = reader.Read<ErrorKind>();
+        const string message(reader.ReadString());
+        if (kind == ErrorKind::INVALID_ARGUMENT) {
+            throw invalid_argument(message);
+        }
+        throw runtime_error("search worker failed: "s + message);
+    }
+    if (reader.GetType() != expected_type) {
+        throw runtime_error("unexpected search worker reply");
+    }
+    return reader;
+}
+
+}
+
+SearchCoordinator::SearchCoordinator(const vector<string>& worker_socket_paths, size_t max_result_document_count)
+    : max_result_document_count_(max_result_document_count) {
+    try {
+        for (const string& path : worker_socket_paths) {
+            worker_fds_.push_back(ConnectUnixSocket(path));
+        }
+    } catch (...) {
+        for (const int fd : worker_fds_) {
+            close(fd);
+        }
+        throw;
+    }
+}
+
+SearchCoordinator::~SearchCoordinator() {
+    for (const int fd : worker_fds_) {
+        close(fd);
+    }
+}
+
+vector<Document> SearchCoordinator::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    vector<string_view> plus_words;
+    for (const string_view word : SplitIntoWords(raw_query)) {
+        // minus words only exclude, and stop words and invalid words are left to the workers
+        if (!word.empty() && word[0] != '-') {
+            plus_words.push_back(word);
+        }
+    }
+    sort(plus_words.begin(), plus_words.end());
+    plus_words.erase(unique(plus_words.begin(), plus_words.end()), plus_words.end());
+
+    lock_guard guard(mutex_);
+    const CollectionStatistics statistics = GatherStatistics(plus_words);
+
+    MessageWriter request(MessageType::TOP_DOCUMENTS);
+    request.WriteString(raw_query);
+    request.Write(static_cast<uint8_t>(status));
+    request.Write<int32_t>(statistics.document_count);
+    request.Write(static_cast<uint32_t>(statistics.document_freqs.size()));
+    for (const auto& [word, document_freq] : statistics.document_freqs) {
+        request.WriteString(word);
+        request.Write<int32_t>(document_freq);
+    }
+
+    TopDocumentsCollector top_documents(max_result_document_count_);
+    for (const string& reply : Exchange(request.GetPayload())) {
+        MessageReader reader = ReadReply(reply, MessageType::TOP_DOCUMENTS);
+        for (uint32_t document_count = reader.Read<uint32_t>(); document_count > 0; --document_count) {
+            Document document;
+            document.id = reader.Read<int32_t>();
+            document.relevance = reader.Read<double>();
+            document.rating = reader.Read<int32_t>();
+            top_documents.Add(document);
+        }
+    }
+    return top_documents.Extract();
+}
+
+vector<Document> SearchCoordinator::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int SearchCoordinator::GetDocumentCount() const {
+    lock_guard guard(mutex_);
+    return GatherStatistics({}).document_count;
+}
+
+size_t SearchCoordinator::GetWorkerCount() const {
+    return worker_fds_.size();
+}
+
+CollectionStatistics SearchCoordinator::GatherStatistics(const vector<string_view>& words) const {
+    MessageWriter request(MessageType::DOCUMENT_FREQS);
+    request.Write(static_cast<uint32_t>(words.size()));
+    for (const string_view word : words) {
+        request.WriteString(word);
+    }
+
+    CollectionStatistics statistics;
+    for (const string& reply : Exchange(request.GetPayload())) {
+        MessageReader reader = ReadReply(reply, MessageType::DOCUMENT_FREQS);
+        statistics.document_count += reader.Read<int32_t>();
+        for (const string_view word : words) {
+            statistics.document_freqs[word] += reader.Read<int32_t>();
+        }
+    }
+    return statistics;
+}
+
+vector<string> SearchCoordinator::Exchange(const string& request) const {
+    if (is_broken_) {
+        throw runtime_error("search coordinator lost a worker connection");
+    }
+    vector<string> replies(worker_fds_.size());
+    try {
+        for (const int fd : worker_fds_) {
+            SendMessage(fd, request);
+        }
+        for (size_t i = 0; i < worker_fds_.size(); ++i) {
+            if (!ReceiveMessage(worker_fds_[i], replies[i])) {
+                throw runtime_error("search worker closed the connection");
+            }
+        }
+    } catch (...) {
+        // the other workers' replies to this request would be read as replies to the next one
+        is_broken_ = true;
+        throw;
+    }
+    return replies;
+}
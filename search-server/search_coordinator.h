@@ -0,0 +1,53 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Answers queries over a collection partitioned across SearchWorker processes. A query
+// first gathers the document frequencies of its plus words from every worker, then has
+// every worker rank its documents with those of the whole collection and merges their
+// top documents, so results rank as one index of all documents would. Requests go out to
+// all workers before any reply is read, so the workers search in parallel.
+// Queries are serialized; workers must not change while a query runs.
+class SearchCoordinator {
+public:
+    // Connects to the worker sockets. Workers must return at least max_result_document_count
+    // documents per query for the merged top to be complete.
+    explicit SearchCoordinator(const std::vector<std::string>& worker_socket_paths,
+                               size_t max_result_document_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    ~SearchCoordinator();
+
+    SearchCoordinator(const SearchCoordinator&) = delete;
+    SearchCoordinator& operator=(const SearchCoordinator&) = delete;
+
+    // Throws std::invalid_argument for an invalid query and std::runtime_error when a
+    // worker fails or can not be reached. A failed connection may leave replies unread, so
+    // every later call throws std::runtime_error too and the coordinator must be created again
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetWorkerCount() const;
+
+private:
+    std::vector<int> worker_fds_;
+    size_t max_result_document_count_;
+    // requests and replies of one query must not interleave with another's
+    mutable std::mutex mutex_;
+    // set under mutex_ once sending or receiving fails
+    mutable bool is_broken_ = false;
+
+    // Document count and document frequencies of the words, summed over the workers
+    CollectionStatistics GatherStatistics(const std::vector<std::string_view>& words) const;
+
+    // Sends the request to every worker, then returns their replies in worker order; throws
+    // std::runtime_error without sending anything once a connection has failed
+    std::vector<std::string> Exchange(const std::string& request) const;
+};
@@ -0,0 +1,144 @@
+#include "search_protocol.h"
+
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+sockaddr_un MakeUnixAddress(const string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("socket path too long: "s + path);
+    }
+    memcpy(address.sun_path, path.data(), path.size());
+    return address;
+}
+
+// Reads exactly size bytes; returns false if the peer closed the connection before the first
+void ReceiveExactly(int fd, char* data, size_t size, bool& is_closed) {
+    is_closed = false;
+    size_t received = 0;
+    while (received < size) {
+        const ssize_t result = recv(fd, data + received, size - received, 0);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            throw runtime_error("cannot receive a search message");
+        }
+        if (result == 0) {
+            if (received == 0) {
+                is_closed = true;
+                return;
+            }
+            throw runtime_error("search connection closed inside a message");
+        }
+        received += static_cast<size_t>(result);
+    }
+}
+
+}
+
+MessageWriter::MessageWriter(MessageType type) {
+    Write(type);
+}
+
+void MessageWriter::WriteString(string_view str) {
+    Write(static_cast<uint32_t>(str.size()));
+    payload_.append(str);
+}
+
+const string& MessageWriter::GetPayload() const {
+    return payload_;
+}
+
+MessageReader::MessageReader(string_view payload)
+    : payload_(payload) {
+    type_ = Read<MessageType>();
+}
+
+MessageType MessageReader::GetType() const {
+    return type_;
+}
+
+string_view MessageReader::ReadString() {
+    return Take(Read<uint32_t>());
+}
+
+string_view MessageReader::Take(size_t size) {
+    if (payload_.size() < size) {
+        throw runtime_error("truncated search message");
+    }
+    const string_view data = payload_.substr(0, size);
+    payload_.remove_prefix(size);
+    return data;
+}
+
+void SendMessage(int fd, const string& payload) {
+    const uint32_t size = static_cast<uint32_t>(payload.size());
+    string message(reinterpret_cast<const char*>(&size), sizeof(size));
+    message += payload;
+    size_t sent = 0;
+    while (sent < message.size()) {
+        // a closed peer is reported as an error instead of raising SIGPIPE
+        const ssize_t result = send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            throw runtime_error("cannot send a search message");
+        }
+        sent += static_cast<size_t>(result);
+    }
+}
+
+bool ReceiveMessage(int fd, string& payload) {
+    uint32_t size = 0;
+    bool is_closed = false;
+    ReceiveExactly(fd, reinterpret_cast<char*>(&size), sizeof(size), is_closed);
+    if (is_closed) {
+        return false;
+    }
+    if (size > MAX_MESSAGE_SIZE) {
+        throw runtime_error("search message too large");
+    }
+    payload.resize(size);
+    ReceiveExactly(fd, payload.data(), size, is_closed);
+    if (is_closed && size > 0) {
+        throw runtime_error("search connection closed inside a message");
+    }
+    return true;
+}
+
+int ListenUnixSocket(const string& path) {
+    const sockaddr_un address = MakeUnixAddress(path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw runtime_error("cannot create a socket");
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        throw runtime_error("cannot listen on "s + path);
+    }
+    return fd;
+}
+
+int ConnectUnixSocket(const string& path) {
+    const sockaddr_un address = MakeUnixAddress(path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw runtime_error("cannot create a socket");
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        throw runtime_error("cannot connect to "s + path);
+    }
+    return fd;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Binary protocol between a SearchCoordinator and its SearchWorkers over Unix domain
+// sockets. Every message is a uint32 payload size followed by the payload, whose first
+// byte is a MessageType. Numbers travel in host byte order, since both ends run on one
+// machine; strings are a uint32 size and the characters.
+//
+//   DOCUMENT_FREQS request   uint32 word count, words...
+//   DOCUMENT_FREQS response  int32 document count, int32 freq of every word in turn
+//   TOP_DOCUMENTS request    raw query, uint8 status, int32 document count,
+//                            uint32 word count, (word, int32 freq)...
+//   TOP_DOCUMENTS response   uint32 document count, (int32 id, double relevance, int32 rating)...
+//   ERROR response           uint8 ErrorKind, message
+enum class MessageType : uint8_t {
+    DOCUMENT_FREQS = 1,
+    TOP_DOCUMENTS = 2,
+    ERROR = 3,
+};
+
+enum class ErrorKind : uint8_t {
+    INVALID_ARGUMENT = 1,
+    INTERNAL = 2,
+};
+
+// Larger messages are taken for a corrupted stream
+const uint32_t MAX_MESSAGE_SIZE = 64 << 20;
+
+class MessageWriter {
+public:
+    explicit MessageWriter(MessageType type);
+
+    template <typename T>
+    void Write(T value);
+
+    void WriteString(std::string_view str);
+
+    const std::string& GetPayload() const;
+
+private:
+    std::string payload_;
+};
+
+// Throws std::runtime_error when the payload ends before a value
+class MessageReader {
+public:
+    explicit MessageReader(std::string_view payload);
+
+    MessageType GetType() const;
+
+    template <typename T>
+    T Read();
+
+    std::string_view ReadString();
+
+private:
+    std::string_view payload_;
+    MessageType type_;
+
+    std::string_view Take(size_t size);
+};
+
+// Both throw std::runtime_error when the socket fails
+void SendMessage(int fd, const std::string& payload);
+// Returns false when the peer closed the connection between messages
+bool ReceiveMessage(int fd, std::string& payload);
+
+// Both return an open socket descriptor or throw std::runtime_error. Listening replaces a
+// stale socket file at the path.
+int ListenUnixSocket(const std::string& path);
+int ConnectUnixSocket(const std::string& path);
+
+template <typename T>
+void MessageWriter::Write(T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    payload_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T MessageReader::Read() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T value;
+    std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+    return value;
+}
@@ -1,76 +1,431 @@
 #include "search_server.h"
 
+#include "parallel_for.h"
+
 using namespace std;
 
 SearchServer::SearchServer(const string& stop_words_text): SearchServer(SplitIntoWords(stop_words_text)) 
 {
 }
 
-SearchServer::SearchServer(const string_view stop_words_text): SearchServer(SplitIntoWords(static_cast<string>(stop_words_text)))
+SearchServer::SearchServer(const string_view stop_words_text): SearchServer(SplitIntoWords(stop_words_text))
 {
 }
 
+SearchServer::SearchServer(StopWordSet stop_words)
+    : stop_words_(move(stop_words)) {
+    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+        throw invalid_argument("stop words contain unavailable characters");
+    }
+}
+
 void SearchServer::AddDocument(int document_id, const string_view document, DocumentStatus status, const vector<int>& ratings) {
-    if(document_id < 0 || documents_.count(document_id)){
+    AddDocuments({NewDocument{document_id, document, status, ratings}});
+}
+
+void SearchServer::AddDocuments(const vector<NewDocument>& documents) {
+    vector<PartialIndex> partials;
+    partials.push_back(IndexDocuments(documents.begin(), documents.end()));
+    MergePartialIndexes(partials);
+}
+
+void SearchServer::AddDocuments(execution::parallel_policy policy, const vector<NewDocument>& documents) {
+    const size_t slice_count = min<size_t>(max(1u, thread::hardware_concurrency()), max<size_t>(1, documents.size()));
+    vector<PartialIndex> partials(slice_count);
+    ParallelForSlices(documents.size(), slice_count, [&](size_t slice, size_t first, size_t last) {
+        partials[slice] = IndexDocuments(documents.begin() + first, documents.begin() + last);
+    });
+    MergePartialIndexes(partials);
+}
+
+void SearchServer::AddDocumentsFrom(const vector<DocumentSource>& sources) {
+    vector<PartialIndex> partials;
+    partials.reserve(sources.size());
+    for (const DocumentSource& source : sources) {
+        partials.push_back(source.server->ExportDocuments(source.removed_ids));
+    }
+    MergePartialIndexes(partials);
+}
+
+SearchServer SearchServer::CloneEmpty() const {
+    SearchServer result(stop_words_);
+    result.max_result_document_count_ = max_result_document_count_;
+    result.query_partition_count_ = query_partition_count_;
+    result.reject_duplicates_ = reject_duplicates_;
+    // a copied cache starts empty with the same capacity
+    result.query_results_ = query_results_;
+    return result;
+}
+
+void SearchServer::CompactPostings() {
+    for (PostingList& postings : term_to_document_freqs_) {
+        postings.Seal();
+        postings.ShrinkToFit();
+    }
+}
+
+PartialIndex SearchServer::ExportDocuments(const unordered_set<int>* removed_ids) const {
+    const uint32_t NOT_EXPORTED = UINT32_MAX;
+    PartialIndex partial;
+    vector<uint32_t> local_documents(document_ids_.size(), NOT_EXPORTED);
+    vector<DocumentOrdinal> ordinals;
+    for (const auto [document_id, ordinal] : documents_) {
+        if (!removed_ids || !removed_ids->count(document_id)) {
+            ordinals.push_back(ordinal);
+        }
+    }
+    // local numbers in ordinal order keep every exported posting list sorted
+    sort(ordinals.begin(), ordinals.end());
+    for (uint32_t local_document = 0; local_document < ordinals.size(); ++local_document) {
+        local_documents[ordinals[local_document]] = local_document;
+    }
+
+    vector<uint32_t> local_terms(term_to_document_freqs_.size(), NOT_EXPORTED);
+    for (TermId term = 0; term < term_to_document_freqs_.size(); ++term) {
+        term_to_document_freqs_[term].ForEachPosting([&](const PostingList::Posting& posting) {
+            const uint32_t local_document = local_documents[posting.ordinal];
+            if (local_document == NOT_EXPORTED) {
+                return;
+            }
+            if (local_terms[term] == NOT_EXPORTED) {
+                local_terms[term] = partial.AddTerm(terms_.GetTerm(term));
+            }
+            partial.postings[local_terms[term]].push_back({local_document, posting.term_count, posting.document_length});
+        });
+    }
+
+    partial.documents.reserve(ordinals.size());
+    for (const DocumentOrdinal ordinal : ordinals) {
+        PartialIndex::DocumentEntry entry{document_ids_[ordinal], document_ratings_[ordinal],
+                                          document_statuses_[ordinal], {}, {}, document_fingerprints_[ordinal]};
+        for (const TermId term : document_terms_[ordinal]) {
+            entry.terms.push_back(local_terms[term]);
+        }
+        entry.term_freqs.assign(document_term_freqs_[ordinal].begin(), document_term_freqs_[ordinal].end());
+        partial.documents.push_back(move(entry));
+    }
+    return partial;
+}
+
+PartialIndex SearchServer::IndexDocuments(vector<NewDocument>::const_iterator first,
+                                          vector<NewDocument>::const_iterator last) const {
+    PartialIndex partial;
+    partial.documents.reserve(distance(first, last));
+    vector<uint32_t> document_terms;
+    vector<uint64_t> word_hashes;
+    vector<string_view> words;
+    for (auto it = first; it != last; ++it) {
+        if (it->id < 0) {
+            throw invalid_argument("invalid id");
+        }
+        SplitIntoWordsNoStop(it->text, words);
+        const auto document_length = static_cast<uint32_t>(words.size());
+        document_terms.clear();
+        for (const string_view word : words) {
+            document_terms.push_back(partial.AddTerm(word));
+        }
+        sort(document_terms.begin(), document_terms.end());
+
+        const auto local_document = static_cast<uint32_t>(partial.documents.size());
+        PartialIndex::DocumentEntry entry{it->id, ComputeAverageRating(it->ratings), it->status, {}, {}, 0};
+        for (auto term_it = document_terms.begin(); term_it != document_terms.end();) {
+            const uint32_t term = *term_it;
+            const auto term_end = upper_bound(term_it, document_terms.end(), term);
+            const auto term_count = static_cast<uint32_t>(term_end - term_it);
+            term_it = term_end;
+            // computed the way PostingList decodes it, so both report the same frequency
+            entry.terms.push_back(term);
+            entry.term_freqs.push_back(static_cast<double>(term_count) / document_length);
+            partial.postings[term].push_back({local_document, term_count, document_length});
+        }
+        word_hashes.clear();
+        for (const uint32_t term : entry.terms) {
+            word_hashes.push_back(ComputeWordHash(partial.terms[term]));
+        }
+        entry.fingerprint = ComputeDocumentFingerprint(word_hashes);
+        partial.documents.push_back(move(entry));
+    }
+    return partial;
+}
+
+void SearchServer::MergePartialIndexes(const vector<PartialIndex>& partials) {
+    vector<int> batch_ids;
+    for (const PartialIndex& partial : partials) {
+        for (const auto& document : partial.documents) {
+            if (document.id < 0 || documents_.count(document.id)) {
+                throw invalid_argument("invalid id");
+            }
+            batch_ids.push_back(document.id);
+        }
+    }
+    sort(batch_ids.begin(), batch_ids.end());
+    if (adjacent_find(batch_ids.begin(), batch_ids.end()) != batch_ids.end()) {
         throw invalid_argument("invalid id");
     }
-    const auto words = SplitIntoWordsNoStop(document);
-    const double inv_word_count = 1.0 / words.size();
-    for (auto word : words) {
-        if(!IsValidWord(word)){
-            throw invalid_argument("document contains unavailable characters");
+
+    struct TermPostings {
+        TermId term;
+        uint32_t partial;
+        uint32_t local_term;
+    };
+    vector<vector<TermId>> global_terms(partials.size());
+    vector<TermPostings> term_postings;
+    for (uint32_t partial = 0; partial < partials.size(); ++partial) {
+        const auto& local_terms = partials[partial].terms;
+        global_terms[partial].resize(local_terms.size());
+        for (uint32_t local_term = 0; local_term < local_terms.size(); ++local_term) {
+            const TermId term = terms_.Intern(local_terms[local_term]);
+            global_terms[partial][local_term] = term;
+            term_postings.push_back({term, partial, local_term});
+        }
+    }
+    term_to_document_freqs_.resize(terms_.GetTermCount());
+    inverse_document_freqs_.Resize(terms_.GetTermCount());
+    inverse_document_freqs_.Invalidate();
+    query_results_.Invalidate();
+
+    const auto get_sorted_terms = [&](uint32_t partial, uint32_t document) {
+        vector<TermId> terms;
+        for (const uint32_t local_term : partials[partial].documents[document].terms) {
+            terms.push_back(global_terms[partial][local_term]);
+        }
+        sort(terms.begin(), terms.end());
+        return terms;
+    };
+    const DocumentOrdinal NO_ORDINAL = UINT32_MAX;
+    // ordinals of the documents of every partial, NO_ORDINAL for rejected duplicates
+    vector<vector<DocumentOrdinal>> ordinals(partials.size());
+    vector<TermId> rejected_terms;
+    auto next_ordinal = static_cast<DocumentOrdinal>(document_ids_.size());
+    // accepted documents of the batch by fingerprint, as partial and document
+    unordered_multimap<uint64_t, pair<uint32_t, uint32_t>> batch_fingerprints;
+    for (uint32_t partial = 0; partial < partials.size(); ++partial) {
+        const auto& documents = partials[partial].documents;
+        ordinals[partial].reserve(documents.size());
+        for (uint32_t document = 0; document < documents.size(); ++document) {
+            if (!reject_duplicates_) {
+                ordinals[partial].push_back(next_ordinal++);
+                continue;
+            }
+            // the word sets are compared only on a fingerprint match, so a collision can not reject a document
+            const uint64_t fingerprint = documents[document].fingerprint;
+            vector<TermId> terms;
+            bool is_duplicate = false;
+            for (auto [it, end] = fingerprint_index_.equal_range(fingerprint); it != end && !is_duplicate; ++it) {
+                if (terms.empty()) {
+                    terms = get_sorted_terms(partial, document);
+                }
+                const auto& other_terms = document_terms_[it->second];
+                is_duplicate = equal(terms.begin(), terms.end(), other_terms.begin(), other_terms.end());
+            }
+            for (auto [it, end] = batch_fingerprints.equal_range(fingerprint); it != end && !is_duplicate; ++it) {
+                if (terms.empty()) {
+                    terms = get_sorted_terms(partial, document);
+                }
+                is_duplicate = terms == get_sorted_terms(it->second.first, it->second.second);
+            }
+            if (is_duplicate) {
+                ordinals[partial].push_back(NO_ORDINAL);
+                rejected_terms.insert(rejected_terms.end(), terms.begin(), terms.end());
+                ++rejected_duplicate_count_;
+            } else {
+                ordinals[partial].push_back(next_ordinal++);
+                batch_fingerprints.emplace(fingerprint, pair(partial, document));
+            }
         }
     }
-    for (const auto &word : words) {
-        word_to_document_freqs_[static_cast<string>(word)][document_id] += inv_word_count;
-        id_to_string_freq_[document_id][static_cast<string>(word)] += inv_word_count;
+
+    const bool is_bulk = next_ordinal - document_ids_.size() >= POSTING_SEAL_MIN_BATCH_SIZE;
+    // grouped by term with the partials in batch order, every posting list gets one
+    // reservation and then only appends of ascending ordinals
+    sort(term_postings.begin(), term_postings.end(), [](const TermPostings& lhs, const TermPostings& rhs) {
+        return tie(lhs.term, lhs.partial) < tie(rhs.term, rhs.partial);
+    });
+    for (auto group = term_postings.begin(); group != term_postings.end();) {
+        const auto group_end = find_if(group, term_postings.end(),
+                                       [term = group->term](const TermPostings& item) { return item.term != term; });
+        size_t added = 0;
+        for (auto it = group; it != group_end; ++it) {
+            added += partials[it->partial].postings[it->local_term].size();
+        }
+        PostingList& postings = term_to_document_freqs_[group->term];
+        minus_word_bitmaps_.Invalidate(group->term);
+        postings.Reserve(added);
+        for (auto it = group; it != group_end; ++it) {
+            for (const auto& posting : partials[it->partial].postings[it->local_term]) {
+                const DocumentOrdinal ordinal = ordinals[it->partial][posting.document];
+                if (ordinal != NO_ORDINAL) {
+                    postings.Add(ordinal, posting.term_count, posting.document_length);
+                }
+            }
+        }
+        if (is_bulk) {
+            postings.Seal();
+        }
+        group = group_end;
+    }
+
+    vector<pair<TermId, double>> document_terms;
+    for (uint32_t partial = 0; partial < partials.size(); ++partial) {
+        for (uint32_t document_index = 0; document_index < partials[partial].documents.size(); ++document_index) {
+            if (ordinals[partial][document_index] == NO_ORDINAL) {
+                continue;
+            }
+            const auto& document = partials[partial].documents[document_index];
+            document_terms.clear();
+            for (size_t i = 0; i < document.terms.size(); ++i) {
+                document_terms.emplace_back(global_terms[partial][document.terms[i]], document.term_freqs[i]);
+            }
+            sort(document_terms.begin(), document_terms.end());
+
+            vector<TermId> terms(document_terms.size());
+            vector<double> term_freqs(document_terms.size());
+            for (size_t i = 0; i < document_terms.size(); ++i) {
+                terms[i] = document_terms[i].first;
+                term_freqs[i] = document_terms[i].second;
+            }
+            const auto ordinal = static_cast<DocumentOrdinal>(document_ids_.size());
+            document_terms_.push_back(move(terms));
+            document_term_freqs_.push_back(move(term_freqs));
+            document_ids_.push_back(document.id);
+            document_ratings_.push_back(document.rating);
+            document_statuses_.push_back(document.status);
+            document_fingerprints_.push_back(document.fingerprint);
+            if (reject_duplicates_) {
+                fingerprint_index_.emplace(document.fingerprint, ordinal);
+            }
+            documents_.emplace(document.id, ordinal);
+            ids_.insert(document.id);
+        }
+    }
+    // words only the rejected documents had
+    if (!rejected_terms.empty()) {
+        sort(rejected_terms.begin(), rejected_terms.end());
+        rejected_terms.erase(unique(rejected_terms.begin(), rejected_terms.end()), rejected_terms.end());
+        RetireUnusedTerms(rejected_terms);
     }
-    set<string_view> w(words.begin(), words.end());
-    id_words[document_id] = w;
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
-    ids_.insert(document_id);
 }
 
 vector<Document> SearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(
-        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+    const Query query = ParseQuery(raw_query, true);
+    return FindCachedTopDocuments(query, status, [&] {
+        return FindAllDocuments(query, [status](int document_id, DocumentStatus document_status, int rating) {
             return document_status == status;
         });
+    });
 }
 
 vector<Document> SearchServer::FindTopDocuments(const string_view raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+vector<Document> SearchServer::FindTopDocuments(QueryEvaluation evaluation, const string_view raw_query,
+                                               DocumentStatus status) const {
+    const Query query = ParseQuery(raw_query, true);
+    return FindCachedTopDocuments(query, status, [&] {
+        return FindAllDocuments(evaluation, query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        });
+    });
+}
+
+vector<Document> SearchServer::FindTopDocuments(QueryEvaluation evaluation, const string_view raw_query) const {
+    return FindTopDocuments(evaluation, raw_query, DocumentStatus::ACTUAL);
+}
+
+vector<Document> SearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status, QueryDeadline deadline) const {
+    const Query query = ParseQuery(raw_query, true);
+    return FindCachedTopDocuments(query, status, [&] {
+        return FindAllDocuments(query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        }, deadline);
+    });
+}
+
 int SearchServer::GetDocumentCount() const {
     return documents_.size();
 }
 
+bool SearchServer::ContainsDocument(int document_id) const {
+    return documents_.count(document_id) > 0;
+}
+
+uint64_t SearchServer::GetDocumentFingerprint(int document_id) const {
+    return document_fingerprints_[documents_.at(document_id)];
+}
+
+void SearchServer::SetDuplicateRejection(bool reject_duplicates) {
+    reject_duplicates_ = reject_duplicates;
+    fingerprint_index_.clear();
+    if (reject_duplicates_) {
+        fingerprint_index_.reserve(documents_.size());
+        for (const auto [document_id, ordinal] : documents_) {
+            fingerprint_index_.emplace(document_fingerprints_[ordinal], ordinal);
+        }
+    }
+}
+
+size_t SearchServer::GetRejectedDuplicateCount() const {
+    return rejected_duplicate_count_;
+}
+
+int SearchServer::GetDocumentFreq(string_view word) const {
+    const TermId term = terms_.Find(word);
+    return term == TermDictionary::NO_TERM ? 0 : static_cast<int>(term_to_document_freqs_[term].GetDocumentFreq());
+}
+
+void SearchServer::SetMaxResultDocumentCount(size_t count) {
+    max_result_document_count_ = count;
+    query_results_.Invalidate();
+}
+
+size_t SearchServer::GetMaxResultDocumentCount() const {
+    return max_result_document_count_;
+}
+
+void SearchServer::SetQueryPartitionCount(size_t count) {
+    if (count == 0) {
+        throw invalid_argument("query partition count must be positive");
+    }
+    query_partition_count_ = count;
+}
+
+size_t SearchServer::GetQueryPartitionCount() const {
+    return query_partition_count_;
+}
+
+void SearchServer::SetQueryCacheCapacity(size_t capacity) {
+    query_results_.SetCapacity(capacity);
+}
+
+QueryCacheStats SearchServer::GetQueryCacheStats() const {
+    return query_results_.GetStats();
+}
+
 words_docstatus SearchServer::MatchDocument(string_view raw_query, int document_id) const {
     if (!documents_.count(document_id)) {
         throw out_of_range("");
     }
     const Query query = ParseQuery(raw_query, true);
+    const DocumentOrdinal ordinal = documents_.at(document_id);
 
-    auto& words = id_words.at(document_id);
-
-    for (string_view word : query.minus_words) {
-        if(words.count(word)) {
-            return {{}, documents_.at(document_id).status};
+    for (const TermId term : query.minus_terms) {
+        if(DocumentHasTerm(ordinal, term)) {
+            return tuple(vector<string_view>{}, document_statuses_[ordinal]);
         }
     }
 
     vector<string_view> matched_words;
-    matched_words.reserve(query.plus_words.size());
+    matched_words.reserve(query.plus_terms.size());
     
-    for (string_view word: query.plus_words) {
-        if(words.count(word)) {
-            matched_words.push_back(word);
+    for (const TermId term : query.plus_terms) {
+        if(DocumentHasTerm(ordinal, term)) {
+            matched_words.push_back(terms_.GetTerm(term));
         }
     }
+    sort(matched_words.begin(), matched_words.end());
 
-
-    return tuple(matched_words, documents_.at(document_id).status);
+    return tuple(matched_words, document_statuses_[ordinal]);
 }
 
 words_docstatus SearchServer::MatchDocument(execution::sequenced_policy policy, 
@@ -84,66 +439,53 @@ words_docstatus SearchServer::MatchDocument(execution::parallel_policy policy,
         throw out_of_range("");
     }
     Query query = ParseQuery(raw_query, false);
-    auto& words = id_words.at(document_id);
+    const DocumentOrdinal ordinal = documents_.at(document_id);
 
-    for (string_view word: query.minus_words) {
-        if(words.count(word)) {
-            return {{}, documents_.at(document_id).status};
-        }
+    if (any_of(policy, query.minus_terms.begin(), query.minus_terms.end(),
+               [&](const TermId term) { return DocumentHasTerm(ordinal, term); })) {
+        return tuple(vector<string_view>{}, document_statuses_[ordinal]);
     }
 
-    sort(query.plus_words.begin(), query.plus_words.end());
-    auto plus_words_end = unique(query.plus_words.begin(), query.plus_words.end());
+    sort(query.plus_terms.begin(), query.plus_terms.end());
+    auto plus_terms_end = unique(query.plus_terms.begin(), query.plus_terms.end());
 
+    vector<TermId> matched_terms(distance(query.plus_terms.begin(), plus_terms_end));
+    auto matched_terms_end = copy_if(policy, query.plus_terms.begin(), plus_terms_end, matched_terms.begin(),
+                                     [&](const TermId term) { return DocumentHasTerm(ordinal, term); });
 
-    vector<string_view> matched_words;
-    matched_words.reserve(distance(query.plus_words.begin(), plus_words_end));
-
-    // copy_if(policy, query.plus_words.begin(), plus_words_end, back_inserter(matched_words),
-    //         [&](const string& word){return words.count(word);});
-
-    mutex m;
-
-    for_each(policy, query.plus_words.begin(), plus_words_end, [&](const auto& word)
-                    {if(words.count(word)) {
-                        lock_guard guard(m);
-                        matched_words.push_back(word);
-                        };
-                    }
-            );
+    vector<string_view> matched_words(distance(matched_terms.begin(), matched_terms_end));
+    transform(matched_terms.begin(), matched_terms_end, matched_words.begin(),
+              [this](const TermId term) { return terms_.GetTerm(term); });
+    sort(matched_words.begin(), matched_words.end());
 
-    return tuple(matched_words, documents_.at(document_id).status);
+    return tuple(matched_words, document_statuses_[ordinal]);
 }
 
 bool SearchServer::IsStopWord(string_view word) const
 {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(string_view word)
 {
     // A valid word must not contain special characters
-    return none_of(word.begin(), word.end(), [](char c)
-                   { return c >= '\0' && c < ' '; });
+    return !ContainsControlCharacters(word);
 }
 
-void SearchServer::IsValidQueryWord(string_view word) const {
-    if (!IsValidWord(word) || word.empty() || word[0] == '-'){
+void SearchServer::IsValidQueryWord(string_view word, bool check_characters) {
+    if (word.empty() || word[0] == '-' || (check_characters && !IsValidWord(word))) {
             throw invalid_argument("query contains unavailable characters");
         }
 }
 
-vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text) const {
-    vector<string_view> words;
-    for (const string_view& word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw invalid_argument("Word "s + string(word) + " is invalid"s);
-        }
-        if (!IsStopWord(word)) {
-            words.push_back(move(word));
-        }
+void SearchServer::SplitIntoWordsNoStop(string_view text, vector<string_view>& words) const {
+    if (!SplitIntoWords(text, words)) {
+        // the tokenizer only tells that some word is invalid
+        const auto invalid_word = find_if_not(words.begin(), words.end(), IsValidWord);
+        throw invalid_argument("Word "s + string(*invalid_word) + " is invalid"s);
     }
-    return words;
+    words.erase(remove_if(words.begin(), words.end(), [this](string_view word) { return IsStopWord(word); }),
+                words.end());
 }
 
 int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
@@ -157,6 +499,17 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
+void SearchServer::ValidateQuery(string_view raw_query) {
+    thread_local vector<string_view> words;
+    const bool has_control_characters = !SplitIntoWords(raw_query, words);
+    for (string_view word : words) {
+        if (word[0] == '-') {
+            word.remove_prefix(1);
+        }
+        IsValidQueryWord(word, has_control_characters);
+    }
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(string_view& text) const {
     bool is_minus = false;
     // Word shouldn't be empty
@@ -169,35 +522,173 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view& text) const {
 
 SearchServer::Query SearchServer::ParseQuery(string_view text, bool unique_) const {
     Query query;
-    auto words = SplitIntoWords(text);
-    query.plus_words.reserve(words.size());
-    query.minus_words.reserve(words.size());
+    // reused by the queries of a thread, which the tokenizer fills without allocating
+    thread_local vector<string_view> words;
+    const bool has_control_characters = !SplitIntoWords(text, words);
+    query.plus_terms.reserve(words.size());
+    query.minus_terms.reserve(words.size());
      for (string_view word : words) {  
         const QueryWord query_word = ParseQueryWord(word);
-        IsValidQueryWord(query_word.data);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                query.minus_words.push_back(move(query_word.data));
-            }
-            else {
-                query.plus_words.push_back(move(query_word.data));
-            }
+        IsValidQueryWord(query_word.data, has_control_characters);
+        if (query_word.is_stop) {
+            continue;
+        }
+        const TermId term = terms_.Find(query_word.data);
+        if (term == TermDictionary::NO_TERM) {
+            continue;
+        }
+        if (query_word.is_minus) {
+            query.minus_terms.push_back(term);
+        }
+        else {
+            query.plus_terms.push_back(term);
         }
     }
     if (unique_) {
-        sort(query.minus_words.begin(), query.minus_words.end());
-        auto minus_words_end = unique(query.minus_words.begin(), query.minus_words.end());
-        query.minus_words.erase(minus_words_end, query.minus_words.end());
+        sort(query.minus_terms.begin(), query.minus_terms.end());
+        auto minus_terms_end = unique(query.minus_terms.begin(), query.minus_terms.end());
+        query.minus_terms.erase(minus_terms_end, query.minus_terms.end());
 
-        sort(query.plus_words.begin(), query.plus_words.end());
-        auto plus_words_end = unique(query.plus_words.begin(), query.plus_words.end());
-        query.plus_words.erase(plus_words_end, query.plus_words.end());
+        sort(query.plus_terms.begin(), query.plus_terms.end());
+        auto plus_terms_end = unique(query.plus_terms.begin(), query.plus_terms.end());
+        query.plus_terms.erase(plus_terms_end, query.plus_terms.end());
     }
     return query;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const string& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+double SearchServer::ComputeWordInverseDocumentFreq(TermId term) const {
+    return inverse_document_freqs_.Get(term, [this, term] {
+        return log(GetDocumentCount() * 1.0 / term_to_document_freqs_[term].GetDocumentFreq());
+    });
+}
+
+vector<double> SearchServer::ComputeInverseDocumentFreqs(const Query& query) const {
+    vector<double> inverse_document_freqs(query.plus_terms.size(), 0.0);
+    for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+        if (!term_to_document_freqs_[query.plus_terms[i]].IsEmpty()) {
+            inverse_document_freqs[i] = ComputeWordInverseDocumentFreq(query.plus_terms[i]);
+        }
+    }
+    return inverse_document_freqs;
+}
+
+bool SearchServer::IsFrequentMinusWord(TermId term) const {
+    // sparser bitmaps would mostly consist of array containers, which are slower to probe
+    // than walking the postings once, and would crowd the cache with words seldom repeated
+    const size_t document_freq = term_to_document_freqs_[term].GetDocumentFreq();
+    return document_freq >= MINUS_WORD_BITMAP_MIN_DOCUMENT_FREQ
+        && document_freq * MINUS_WORD_BITMAP_MAX_SPARSITY >= document_ids_.size();
+}
+
+vector<shared_ptr<const DocumentBitmap>> SearchServer::GetMinusWordBitmaps(const Query& query) const {
+    vector<shared_ptr<const DocumentBitmap>> bitmaps;
+    for (const TermId term : query.minus_terms) {
+        if (!IsFrequentMinusWord(term)) {
+            continue;
+        }
+        const PostingList& postings = term_to_document_freqs_[term];
+        bitmaps.push_back(minus_word_bitmaps_.Get(term, [&postings] {
+            DocumentBitmap bitmap;
+            postings.ForEach([&bitmap](DocumentOrdinal ordinal, double) {
+                bitmap.Add(ordinal);
+            });
+            return bitmap;
+        }));
+    }
+    return bitmaps;
+}
+
+vector<vector<Document>> SearchServer::FindAllDocumentsBatch(const vector<Query>& queries, DocumentStatus status) const {
+    // a term of one or more queries of the batch with the queries it is in
+    struct BatchTerm {
+        PostingList::Cursor cursor;
+        // query indexes with the term's inverse document frequency, zero for minus terms
+        vector<pair<size_t, double>> queries;
+    };
+    struct TermUse {
+        TermId term;
+        size_t query;
+        double inverse_document_freq;
+    };
+    vector<TermUse> plus_uses;
+    vector<TermUse> minus_uses;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const vector<double> inverse_document_freqs = ComputeInverseDocumentFreqs(queries[i]);
+        for (size_t j = 0; j < queries[i].plus_terms.size(); ++j) {
+            if (!term_to_document_freqs_[queries[i].plus_terms[j]].IsEmpty()) {
+                plus_uses.push_back({queries[i].plus_terms[j], i, inverse_document_freqs[j]});
+            }
+        }
+        for (const TermId term : queries[i].minus_terms) {
+            if (!term_to_document_freqs_[term].IsEmpty()) {
+                minus_uses.push_back({term, i, 0.0});
+            }
+        }
+    }
+    // ascending TermIds, like the sorted plus terms of every query, so each query sums its
+    // relevance in the same order as FindAllDocuments
+    const auto group = [this](vector<TermUse>& uses) {
+        stable_sort(uses.begin(), uses.end(), [](const TermUse& lhs, const TermUse& rhs) { return lhs.term < rhs.term; });
+        vector<BatchTerm> terms;
+        for (size_t i = 0; i < uses.size(); ++i) {
+            if (i == 0 || uses[i].term != uses[i - 1].term) {
+                terms.push_back({PostingList::Cursor(term_to_document_freqs_[uses[i].term]), {}});
+                terms.back().cursor.Advance(0);
+            }
+            terms.back().queries.emplace_back(uses[i].query, uses[i].inverse_document_freq);
+        }
+        return terms;
+    };
+    vector<BatchTerm> plus_terms = group(plus_uses);
+    vector<BatchTerm> minus_terms = group(minus_uses);
+
+    const size_t ordinal_count = document_ids_.size();
+    const size_t tile_size = max(QUERY_BATCH_MIN_TILE,
+        QUERY_BATCH_ACCUMULATOR_BYTES / ((sizeof(double) + 1) * max<size_t>(1, queries.size())));
+    // indexed by ordinal - first
+    vector<ScoreAccumulator> accumulators(queries.size());
+    vector<TopDocumentsCollector> top_documents(queries.size(), TopDocumentsCollector(max_result_document_count_));
+    for (size_t first = 0; first < ordinal_count; first += tile_size) {
+        const size_t last = min(first + tile_size, ordinal_count);
+        for (ScoreAccumulator& accumulator : accumulators) {
+            accumulator.Reset(last - first);
+        }
+        const auto accepts = [&](DocumentOrdinal offset) {
+            return document_statuses_[first + offset] == status;
+        };
+        for (BatchTerm& term : minus_terms) {
+            for (DocumentOrdinal ordinal; (ordinal = term.cursor.GetOrdinal()) < last; term.cursor.Next()) {
+                for (const auto& [query, inverse_document_freq] : term.queries) {
+                    accumulators[query].Exclude(ordinal - first);
+                }
+            }
+        }
+        for (BatchTerm& term : plus_terms) {
+            for (DocumentOrdinal ordinal; (ordinal = term.cursor.GetOrdinal()) < last; term.cursor.Next()) {
+                const double term_freq = term.cursor.GetTermFreq();
+                for (const auto& [query, inverse_document_freq] : term.queries) {
+                    accumulators[query].Add(ordinal - first, term_freq * inverse_document_freq, accepts);
+                }
+            }
+        }
+        for (size_t i = 0; i < queries.size(); ++i) {
+            accumulators[i].ForEachScored([&](DocumentOrdinal offset, double relevance) {
+                top_documents[i].Add({ document_ids_[first + offset], relevance, document_ratings_[first + offset] });
+            });
+        }
+    }
+
+    vector<vector<Document>> results;
+    results.reserve(queries.size());
+    for (TopDocumentsCollector& collector : top_documents) {
+        results.push_back(collector.Extract());
+    }
+    return results;
+}
+
+bool SearchServer::DocumentHasTerm(DocumentOrdinal ordinal, TermId term) const {
+    const auto& terms = document_terms_[ordinal];
+    return binary_search(terms.begin(), terms.end(), term);
 }
 
 set<int>::const_iterator SearchServer::begin() const {
@@ -208,66 +699,411 @@ set<int>::const_iterator SearchServer::end() const {
     return ids_.end();
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    if(id_to_string_freq_.count(document_id)) {
-        return id_to_string_freq_.at(document_id);
+map<string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    map<string_view, double> word_freqs;
+    if(documents_.count(document_id)) {
+        const DocumentOrdinal ordinal = documents_.at(document_id);
+        for (size_t i = 0; i < document_terms_[ordinal].size(); ++i) {
+            word_freqs.emplace(terms_.GetTerm(document_terms_[ordinal][i]), document_term_freqs_[ordinal][i]);
+        }
     }
-    return {};
+    return word_freqs;
 }
 
 void SearchServer::RemoveDocument(execution::sequenced_policy policy, int document_id) {
-    RemoveDocument(document_id);
+    RemoveSingleDocument(policy, document_id);
 }
 
 void SearchServer::RemoveDocument(execution::parallel_policy policy, int document_id) {
-    if (!documents_.count(document_id)){
-        return;
-        }
+    RemoveSingleDocument(policy, document_id);
+}
 
-	auto& items = id_to_string_freq_.at(document_id);
+void SearchServer::RemoveDocument(int document_id) {
+    RemoveSingleDocument(execution::seq, document_id);
+}
 
-	vector<string> words(items.size());
-    
-	transform(policy, items.begin(), items.end(), words.begin(), [](auto& p) { return p.first; });
+template <typename Execution>
+void SearchServer::RemoveSingleDocument(Execution policy, int document_id) {
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end()) {
+        return;
+    }
+    const DocumentOrdinal ordinal = it->second;
+    const auto& terms = document_terms_[ordinal];
 
-	for_each(policy, words.begin(), words.end(),
-		[&](auto word) {
-			word_to_document_freqs_.at(word).erase(document_id);
-		}
-	);
+    // every term owns its own posting list, so removing from distinct terms does not race
+    for_each(policy, terms.begin(), terms.end(), [&](const TermId term) {
+        term_to_document_freqs_[term].Remove(ordinal);
+    });
 
-    id_to_string_freq_.erase(document_id);
+    for (const TermId term : terms) {
+        minus_word_bitmaps_.Invalidate(term);
+    }
+    RetireUnusedTerms(terms);
+    ForgetFingerprint(ordinal);
     ids_.erase(document_id);
-    documents_.erase(document_id);
-    id_words.erase(document_id);
+    documents_.erase(it);
+    inverse_document_freqs_.Invalidate();
+    query_results_.Invalidate();
+    document_terms_[ordinal] = {};
+    document_term_freqs_[ordinal] = {};
+    CompactOrdinalsIfSparse();
 }
 
-void SearchServer::RemoveDocument(int document_id) {
-    if (!documents_.count(document_id)){
-        return;
+void SearchServer::CompactOrdinalsIfSparse() {
+    const size_t removed_count = document_ids_.size() - documents_.size();
+    if (removed_count >= ORDINAL_COMPACTION_MIN_REMOVED
+        && removed_count * ORDINAL_COMPACTION_MAX_SPARSITY >= document_ids_.size()) {
+        CompactOrdinals();
+    }
+}
+
+void SearchServer::CompactOrdinals() {
+    // live documents keep their order, so every posting list stays sorted
+    const DocumentOrdinal NO_ORDINAL = UINT32_MAX;
+    vector<DocumentOrdinal> new_ordinals(document_ids_.size(), NO_ORDINAL);
+    vector<DocumentOrdinal> live_ordinals;
+    live_ordinals.reserve(documents_.size());
+    for (const auto [document_id, ordinal] : documents_) {
+        live_ordinals.push_back(ordinal);
+    }
+    sort(live_ordinals.begin(), live_ordinals.end());
+    for (DocumentOrdinal i = 0; i < live_ordinals.size(); ++i) {
+        new_ordinals[live_ordinals[i]] = i;
+    }
+
+    for (PostingList& postings : term_to_document_freqs_) {
+        postings = postings.IsEmpty() ? PostingList() : postings.Renumbered(new_ordinals);
+    }
+
+    vector<int> document_ids;
+    vector<int> document_ratings;
+    vector<DocumentStatus> document_statuses;
+    vector<uint64_t> document_fingerprints;
+    vector<MappedArray<TermId>> document_terms;
+    vector<MappedArray<double>> document_term_freqs;
+    document_ids.reserve(live_ordinals.size());
+    document_ratings.reserve(live_ordinals.size());
+    document_statuses.reserve(live_ordinals.size());
+    document_fingerprints.reserve(live_ordinals.size());
+    document_terms.reserve(live_ordinals.size());
+    document_term_freqs.reserve(live_ordinals.size());
+    for (const DocumentOrdinal ordinal : live_ordinals) {
+        document_ids.push_back(document_ids_[ordinal]);
+        document_ratings.push_back(document_ratings_[ordinal]);
+        document_statuses.push_back(document_statuses_[ordinal]);
+        document_fingerprints.push_back(document_fingerprints_[ordinal]);
+        document_terms.push_back(move(document_terms_[ordinal]));
+        document_term_freqs.push_back(move(document_term_freqs_[ordinal]));
+    }
+    document_ids_ = move(document_ids);
+    document_ratings_ = move(document_ratings);
+    document_statuses_ = move(document_statuses);
+    document_fingerprints_ = move(document_fingerprints);
+    document_terms_ = move(document_terms);
+    document_term_freqs_ = move(document_term_freqs);
+
+    for (auto& [document_id, ordinal] : documents_) {
+        ordinal = new_ordinals[ordinal];
+    }
+    SetDuplicateRejection(reject_duplicates_);
+    minus_word_bitmaps_.Clear();
+    query_results_.Invalidate();
+}
+
+RemovalStats SearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    return RemoveDocumentBatch(execution::seq, document_ids);
+}
+
+RemovalStats SearchServer::RemoveDocuments(execution::parallel_policy policy, const vector<int>& document_ids) {
+    return RemoveDocumentBatch(policy, document_ids);
+}
+
+template <typename Execution>
+RemovalStats SearchServer::RemoveDocumentBatch(Execution policy, const vector<int>& document_ids) {
+    RemovalStats stats;
+    vector<DocumentOrdinal> ordinals;
+    ordinals.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        if (const auto it = documents_.find(document_id); it != documents_.end()) {
+            ordinals.push_back(it->second);
         }
+    }
+    sort(ordinals.begin(), ordinals.end());
+    ordinals.erase(unique(ordinals.begin(), ordinals.end()), ordinals.end());
+    if (ordinals.empty()) {
+        return stats;
+    }
 
-    vector<string_view> words;
+    // sorted by term and then ordinal, every group lists the postings to drop from one list
+    vector<pair<TermId, DocumentOrdinal>> removals;
+    for (const DocumentOrdinal ordinal : ordinals) {
+        for (const TermId term : document_terms_[ordinal]) {
+            removals.emplace_back(term, ordinal);
+        }
+    }
+    sort(policy, removals.begin(), removals.end());
+    vector<size_t> group_starts;
+    for (size_t i = 0; i < removals.size(); ++i) {
+        if (i == 0 || removals[i].first != removals[i - 1].first) {
+            group_starts.push_back(i);
+        }
+    }
+    group_starts.push_back(removals.size());
 
-    auto words_for_erase = id_to_string_freq_.at(document_id); 
+    // every group owns its posting list, so groups need no synchronization
+    vector<size_t> groups(group_starts.size() - 1);
+    iota(groups.begin(), groups.end(), 0);
+    const int64_t released_posting_bytes = transform_reduce(policy, groups.begin(), groups.end(), int64_t{0}, plus<>{},
+        [&](size_t group) {
+            vector<DocumentOrdinal> term_ordinals;
+            term_ordinals.reserve(group_starts[group + 1] - group_starts[group]);
+            for (size_t i = group_starts[group]; i < group_starts[group + 1]; ++i) {
+                term_ordinals.push_back(removals[i].second);
+            }
+            PostingList& postings = term_to_document_freqs_[removals[group_starts[group]].first];
+            const auto usage = static_cast<int64_t>(postings.GetMemoryUsage());
+            postings.Remove(term_ordinals);
+            return usage - static_cast<int64_t>(postings.GetMemoryUsage());
+        });
 
-    for (auto [word, freq]: words_for_erase) {
-        words.push_back(word);
+    const size_t term_usage = terms_.GetMemoryUsage();
+    for (size_t group = 0; group + 1 < group_starts.size(); ++group) {
+        const TermId term = removals[group_starts[group]].first;
+        minus_word_bitmaps_.Invalidate(term);
+        if (term_to_document_freqs_[term].IsEmpty()) {
+            term_to_document_freqs_[term] = PostingList();
+            terms_.Retire(term);
+            ++stats.retired_term_count;
+        }
     }
 
-    for (auto word : words) {
-        word_to_document_freqs_.at(string(word)).erase(document_id);
+    int64_t released_bytes = released_posting_bytes + static_cast<int64_t>(term_usage)
+        - static_cast<int64_t>(terms_.GetMemoryUsage());
+    for (const DocumentOrdinal ordinal : ordinals) {
+        const int document_id = document_ids_[ordinal];
+        released_bytes += document_terms_[ordinal].GetMemoryUsage() + document_term_freqs_[ordinal].GetMemoryUsage();
+        ForgetFingerprint(ordinal);
+        ids_.erase(document_id);
+        documents_.erase(document_id);
+        document_terms_[ordinal] = {};
+        document_term_freqs_[ordinal] = {};
     }
+    inverse_document_freqs_.Invalidate();
+    query_results_.Invalidate();
+    CompactOrdinalsIfSparse();
 
-    id_to_string_freq_.erase(document_id);
-    ids_.erase(document_id);
-    documents_.erase(document_id);
-    id_words.erase(document_id);
+    stats.removed_document_count = ordinals.size();
+    // rewriting postings served from a snapshot copies them to the heap
+    stats.reclaimed_bytes = static_cast<size_t>(max<int64_t>(released_bytes, 0));
+    return stats;
+}
+
+void SearchServer::ForgetFingerprint(DocumentOrdinal ordinal) {
+    auto [it, end] = fingerprint_index_.equal_range(document_fingerprints_[ordinal]);
+    for (; it != end; ++it) {
+        if (it->second == ordinal) {
+            fingerprint_index_.erase(it);
+            return;
+        }
+    }
+}
+
+void SearchServer::RetireUnusedTerms(const MappedArray<TermId>& terms) {
+    for (const TermId term : terms) {
+        if (term_to_document_freqs_[term].IsEmpty()) {
+            // the id may be handed out again, so the list starts over empty
+            term_to_document_freqs_[term] = PostingList();
+            terms_.Retire(term);
+        }
+    }
 }
 
 set<string_view> SearchServer::GetWordsById(int doc_id) const {
-    if(id_words.count(doc_id)) {
-        return id_words.at(doc_id);
+    set<string_view> words;
+    if(documents_.count(doc_id)) {
+        for (const TermId term : document_terms_[documents_.at(doc_id)]) {
+            words.insert(terms_.GetTerm(term));
+        }
+    }
+    return words;
+}
+
+void SearchServer::SaveSnapshot(const string& path) const {
+    // live documents are renumbered densely in ordinal order, which keeps every posting list sorted
+    const DocumentOrdinal NO_ORDINAL = UINT32_MAX;
+    vector<DocumentOrdinal> new_ordinals(document_ids_.size(), NO_ORDINAL);
+    vector<DocumentOrdinal> live_ordinals;
+    live_ordinals.reserve(documents_.size());
+    for (const auto [document_id, ordinal] : documents_) {
+        live_ordinals.push_back(ordinal);
+    }
+    sort(live_ordinals.begin(), live_ordinals.end());
+    for (DocumentOrdinal i = 0; i < live_ordinals.size(); ++i) {
+        new_ordinals[live_ordinals[i]] = i;
+    }
+
+    SnapshotHeader header = {};
+    copy(std::begin(SNAPSHOT_MAGIC), std::end(SNAPSHOT_MAGIC), header.magic);
+    header.version = SNAPSHOT_VERSION;
+    header.stop_word_count = stop_words_.size();
+    header.term_count = terms_.GetTermCount();
+    header.document_count = live_ordinals.size();
+
+    SnapshotWriter writer(path);
+    writer.WriteHeader(header);
+    writer.WriteStrings(vector<string_view>(stop_words_.begin(), stop_words_.end()));
+    vector<string_view> terms(header.term_count);
+    for (TermId term = 0; term < header.term_count; ++term) {
+        terms[term] = terms_.GetTerm(term);
+    }
+    writer.WriteStrings(terms);
+
+    // sealed lists are written as they are while no ordinal is unused; only the others are
+    // copied, sealed and renumbered
+    const bool is_dense = live_ordinals.size() == document_ids_.size();
+    vector<PostingList> renumbered_postings;
+    vector<const PostingList*> written_postings;
+    written_postings.reserve(term_to_document_freqs_.size());
+    for (const PostingList& postings : term_to_document_freqs_) {
+        if (!is_dense || !postings.IsSealed()) {
+            renumbered_postings.push_back(postings.Renumbered(new_ordinals));
+        }
+    }
+    for (size_t term = 0, renumbered = 0; term < term_to_document_freqs_.size(); ++term) {
+        const PostingList& postings = term_to_document_freqs_[term];
+        written_postings.push_back(is_dense && postings.IsSealed() ? &postings : &renumbered_postings[renumbered++]);
+    }
+    uint64_t offset = 0;
+    writer.WriteArray(&offset, 1);
+    for (const PostingList* postings : written_postings) {
+        offset += postings->GetBlocks().size();
+        writer.WriteArray(&offset, 1);
+    }
+    header.posting_block_count = offset;
+    offset = 0;
+    writer.WriteArray(&offset, 1);
+    for (const PostingList* postings : written_postings) {
+        offset += postings->GetData().size();
+        writer.WriteArray(&offset, 1);
+    }
+    writer.FinishSection();
+    header.posting_data_size = offset;
+    for (const PostingList* postings : written_postings) {
+        writer.WriteArray(postings->GetBlocks().data(), postings->GetBlocks().size());
+    }
+    writer.FinishSection();
+    for (const PostingList* postings : written_postings) {
+        writer.WriteArray(postings->GetData().data(), postings->GetData().size());
+    }
+    writer.FinishSection();
+
+    for (const DocumentOrdinal ordinal : live_ordinals) {
+        writer.WriteArray(&document_ids_[ordinal], 1);
+    }
+    writer.FinishSection();
+    for (const DocumentOrdinal ordinal : live_ordinals) {
+        writer.WriteArray(&document_ratings_[ordinal], 1);
+    }
+    writer.FinishSection();
+    for (const DocumentOrdinal ordinal : live_ordinals) {
+        writer.WriteArray(&document_statuses_[ordinal], 1);
+    }
+    writer.FinishSection();
+    for (const DocumentOrdinal ordinal : live_ordinals) {
+        writer.WriteArray(&document_fingerprints_[ordinal], 1);
+    }
+    writer.FinishSection();
+
+    offset = 0;
+    writer.WriteArray(&offset, 1);
+    for (const DocumentOrdinal ordinal : live_ordinals) {
+        offset += document_terms_[ordinal].size();
+        writer.WriteArray(&offset, 1);
+    }
+    writer.FinishSection();
+    header.document_term_count = offset;
+    for (const DocumentOrdinal ordinal : live_ordinals) {
+        writer.WriteArray(document_terms_[ordinal].data(), document_terms_[ordinal].size());
+    }
+    writer.FinishSection();
+    for (const DocumentOrdinal ordinal : live_ordinals) {
+        writer.WriteArray(document_term_freqs_[ordinal].data(), document_term_freqs_[ordinal].size());
+    }
+    writer.FinishSection();
+
+    writer.Finish(header);
+}
+
+SearchServer SearchServer::LoadSnapshot(const string& path) {
+    auto file = make_shared<const MappedFile>(path);
+    SnapshotReader reader(*file);
+    const SnapshotHeader header = reader.ReadHeader();
+
+    const vector<string_view> stop_words = reader.ReadStrings(header.stop_word_count);
+    SnapshotReader::Check(all_of(stop_words.begin(), stop_words.end(), IsValidWord));
+    SearchServer server(stop_words);
+    server.snapshot_ = file;
+
+    const vector<string_view> terms = reader.ReadStrings(header.term_count);
+    server.terms_.Reserve(header.term_count);
+    for (const string_view term : terms) {
+        // the position of a term is its TermId, so no term may repeat an earlier one
+        const TermId term_id = server.terms_.InternExternal(term);
+        SnapshotReader::Check(term.empty() || server.terms_.Find(term) == term_id);
+    }
+
+    // block headers are checked against the data and the documents; postings are not decoded
+    const uint64_t* block_offsets = reader.ReadOffsets(header.term_count, header.posting_block_count);
+    const uint64_t* data_offsets = reader.ReadOffsets(header.term_count, header.posting_data_size);
+    const auto* posting_blocks = reader.ReadArray<PostingList::Block>(header.posting_block_count);
+    const uint8_t* posting_data = reader.ReadArray<uint8_t>(header.posting_data_size);
+    server.term_to_document_freqs_.reserve(header.term_count);
+    for (size_t term = 0; term < header.term_count; ++term) {
+        const uint64_t first_block = block_offsets[term];
+        const uint64_t first_byte = data_offsets[term];
+        const uint64_t data_size = data_offsets[term + 1] - first_byte;
+        for (uint64_t i = first_block; i < block_offsets[term + 1]; ++i) {
+            const PostingList::Block& block = posting_blocks[i];
+            SnapshotReader::Check(block.size > 0 && block.size <= PostingList::BLOCK_SIZE
+                                  && block.first_ordinal <= block.last_ordinal
+                                  && block.last_ordinal < header.document_count && block.offset < data_size);
+            SnapshotReader::Check(i == first_block || (posting_blocks[i - 1].last_ordinal < block.first_ordinal
+                                                       && posting_blocks[i - 1].offset < block.offset));
+        }
+        server.term_to_document_freqs_.push_back(
+            PostingList::View(posting_blocks + first_block, block_offsets[term + 1] - first_block,
+                              posting_data + first_byte, data_size));
+    }
+    server.inverse_document_freqs_.Resize(header.term_count);
+
+    const size_t document_count = header.document_count;
+    server.document_ids_ = MappedArray<int>::View(reader.ReadArray<int>(document_count), document_count);
+    server.document_ratings_ = MappedArray<int>::View(reader.ReadArray<int>(document_count), document_count);
+    server.document_statuses_ = MappedArray<DocumentStatus>::View(
+        reader.ReadArray<DocumentStatus>(document_count), document_count);
+    server.document_fingerprints_ = MappedArray<uint64_t>::View(reader.ReadArray<uint64_t>(document_count), document_count);
+
+    SnapshotReader::Check(all_of(server.document_statuses_.begin(), server.document_statuses_.end(),
+                                 [](DocumentStatus status) {
+                                     return status >= DocumentStatus::ACTUAL && status <= DocumentStatus::REMOVED;
+                                 }));
+
+    const uint64_t* document_offsets = reader.ReadOffsets(document_count, header.document_term_count);
+    const TermId* document_terms = reader.ReadArray<TermId>(header.document_term_count);
+    const double* document_freqs = reader.ReadArray<double>(header.document_term_count);
+    SnapshotReader::Check(all_of(document_terms, document_terms + header.document_term_count,
+                                 [&header](TermId term) { return term < header.term_count; }));
+    server.document_terms_.reserve(document_count);
+    server.document_term_freqs_.reserve(document_count);
+    for (DocumentOrdinal ordinal = 0; ordinal < document_count; ++ordinal) {
+        const uint64_t first = document_offsets[ordinal];
+        const size_t size = document_offsets[ordinal + 1] - first;
+        server.document_terms_.push_back(MappedArray<TermId>::View(document_terms + first, size));
+        server.document_term_freqs_.push_back(MappedArray<double>::View(document_freqs + first, size));
+        // ids were written in ordinal order, which is not necessarily sorted, so no insertion hint
+        SnapshotReader::Check(server.documents_.emplace(server.document_ids_[ordinal], ordinal).second);
+        server.ids_.insert(server.document_ids_[ordinal]);
     }
-    return {};
+    return server;
 }
\ No newline at end of file
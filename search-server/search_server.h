@@ -4,48 +4,187 @@
 #include <cmath>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <numeric>
 #include <set>
 #include <stdexcept>
 #include <string_view>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 #include <execution>
 
+#include "bitmap_cache.h"
 #include "document.h"
+#include "document_bitmap.h"
+#include "document_fingerprint.h"
+#include "index_snapshot.h"
+#include "inverse_document_freqs.h"
+#include "mapped_array.h"
+#include "partial_index.h"
 #include "string_processing.h"
 #include "read_input_functions.h"
-#include "concurrent_map.h"
+#include "stop_word_set.h"
+#include "posting_list.h"
+#include "query_deadline.h"
+#include "query_result_cache.h"
+#include "score_accumulator.h"
+#include "term_dictionary.h"
+#include "top_documents.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double CORRECTION = 1e-6;
+
+// Minus words in at least this many documents and in at least 1 of every
+// MINUS_WORD_BITMAP_MAX_SPARSITY documents are excluded through cached bitmaps, rarer
+// ones by walking their postings
+const size_t MINUS_WORD_BITMAP_MIN_DOCUMENT_FREQ = 1024;
+const size_t MINUS_WORD_BITMAP_MAX_SPARSITY = 16;
+
+// Removals renumber the live documents densely once removed documents hold at least
+// ORDINAL_COMPACTION_MIN_REMOVED ordinals and at least 1 of every ORDINAL_COMPACTION_MAX_SPARSITY,
+// so dead slots do not keep growing the per-ordinal columns, accumulators and bitmaps
+const size_t ORDINAL_COMPACTION_MIN_REMOVED = 1024;
+const size_t ORDINAL_COMPACTION_MAX_SPARSITY = 4;
+
+// AddDocuments batches of at least this many documents seal the posting lists they extend,
+// so bulk loaded postings do not wait in uncompressed tails
+const size_t POSTING_SEAL_MIN_BATCH_SIZE = 1024;
+
+// FindTopDocumentsBatch scores ordinal tiles for which the accumulators of all queries of
+// the batch take about this many bytes, but never fewer than QUERY_BATCH_MIN_TILE ordinals
+const size_t QUERY_BATCH_ACCUMULATOR_BYTES = 1 << 19;
+const size_t QUERY_BATCH_MIN_TILE = 256;
+
+// EXHAUSTIVE scores every posting of every plus word. PRUNED evaluates documents one at a
+// time and skips those whose score bound can not reach the current top, ranking the same.
+enum class QueryEvaluation {
+    EXHAUSTIVE,
+    PRUNED,
+};
+
+// Document count and document frequencies of the query words over a collection split into
+// several indexes, so every part ranks its documents the way one index of all of them would
+struct CollectionStatistics {
+    int document_count = 0;
+    std::map<std::string_view, int> document_freqs;
+};
+
+// What a RemoveDocuments call released
+struct RemovalStats {
+    size_t removed_document_count = 0;
+    size_t retired_term_count = 0;
+    // heap bytes of postings, document term lists and interned words given back
+    size_t reclaimed_bytes = 0;
+};
 
 using words_docstatus = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
 class SearchServer {
 public:
+    // Documents of another index, except those whose ids are in removed_ids if it is set
+    struct DocumentSource {
+        const SearchServer* server;
+        const std::unordered_set<int>* removed_ids = nullptr;
+    };
+
     SearchServer() = default;
 
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words);
     explicit SearchServer(const std::string& stop_words_text);
     explicit SearchServer(const std::string_view stop_words_text);
+    // Takes stop words already compiled, such as a StopWordSet of ENGLISH_STOP_WORDS
+    explicit SearchServer(StopWordSet stop_words);
     
     void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Adds all documents of the batch or, if any id or word is invalid, none of them.
+    // Postings are grouped by term, so every posting list is extended once per batch.
+    void AddDocuments(const std::vector<NewDocument>& documents);
+    // Tokenizes and validates slices of the batch on all cores before merging them
+    void AddDocuments(std::execution::parallel_policy policy, const std::vector<NewDocument>& documents);
+
+    // Adds the documents of indexes with the same stop words from their postings, without
+    // tokenizing them again
+    void AddDocumentsFrom(const std::vector<DocumentSource>& sources);
+
+    // An index without documents with the same stop words and settings
+    SearchServer CloneEmpty() const;
+
+    // Encodes the uncompressed tails of all posting lists and gives back their spare
+    // capacity, for an index after bulk loading or one that stops changing
+    void CompactPostings();
+
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(QueryEvaluation evaluation, std::string_view raw_query,
+                                           DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(QueryEvaluation evaluation, std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(QueryEvaluation evaluation, std::string_view raw_query) const;
+    // Ranks every query like FindTopDocuments by status. The queries missing from the cache
+    // are scored together term at a time: every posting list is walked once for all the
+    // queries containing its term. Throws if any of the queries is invalid.
+    // Documents reach the top in another order than in FindTopDocuments, so among documents
+    // tied on relevance and rating the order and the one that makes the cut may differ.
+    template <typename StringContainer>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const StringContainer& raw_queries, DocumentStatus status) const;
+    template <typename StringContainer>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const StringContainer& raw_queries) const;
+    // Throws QueryDeadlineExceeded if scoring is still running when the deadline passes;
+    // cached like other status queries, so a repeated query may be served after it
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, QueryDeadline deadline) const;
     template <typename Execution, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(Execution policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
     template <typename Execution>
     std::vector<Document> FindTopDocuments(Execution policy, std::string_view raw_query, DocumentStatus status) const;
     template <typename Execution>
     std::vector<Document> FindTopDocuments(Execution policy, std::string_view raw_query) const;
+    // Throws std::invalid_argument for a query FindTopDocuments would reject, so a collection
+    // of several indexes rejects it once, however many indexes it has
+    static void ValidateQuery(std::string_view raw_query);
+    // Ranks with the statistics of the whole collection this index is a part of; not cached
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const CollectionStatistics& statistics,
+                                           DocumentPredicate document_predicate) const;
 
     int GetDocumentCount() const;
 
+    bool ContainsDocument(int document_id) const;
+
+    // Zero for words not in the index
+    int GetDocumentFreq(std::string_view word) const;
+
+    // Fingerprint of the document's set of words, computed when it is added
+    uint64_t GetDocumentFingerprint(int document_id) const;
+
+    // While enabled, AddDocuments skips documents with the same set of words as an
+    // indexed document or an earlier document of the batch; off by default. Enabling
+    // indexes the fingerprints of the documents already added.
+    void SetDuplicateRejection(bool reject_duplicates);
+    size_t GetRejectedDuplicateCount() const;
+
+    // How many documents FindTopDocuments returns, MAX_RESULT_DOCUMENT_COUNT by default
+    void SetMaxResultDocumentCount(size_t count);
+    size_t GetMaxResultDocumentCount() const;
+
+    // The parallel FindTopDocuments splits the ordinal space into this many ranges,
+    // which also caps the number of threads a single query occupies
+    void SetQueryPartitionCount(size_t count);
+    size_t GetQueryPartitionCount() const;
+
+    // FindTopDocuments by status caches this many results, QueryResultCache::DEFAULT_CAPACITY
+    // by default; zero disables the cache. Predicate queries are never cached.
+    void SetQueryCacheCapacity(size_t capacity);
+    QueryCacheStats GetQueryCacheStats() const;
+
+    // Returned words view index-owned storage and stay valid until a RemoveDocument
+    // drops the last document containing them
     words_docstatus MatchDocument(const std::string_view raw_query, int document_id) const;    
     words_docstatus MatchDocument(std::execution::sequenced_policy policy, 
                                                                        const std::string_view raw_query, int document_id) const;
@@ -55,24 +194,56 @@ public:
     std::set<int>::const_iterator begin() const;
     std::set<int>::const_iterator end() const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
 
     std::set<std::string_view> GetWordsById(int doc_id) const;
 
     void RemoveDocument(int document_id);
     void RemoveDocument(std::execution::parallel_policy policy, int document_id);
     void RemoveDocument(std::execution::sequenced_policy policy, int document_id);
+
+    // Removes a batch grouped by term, so every affected posting list is rewritten once,
+    // and retires the words no document uses any more. Unknown ids are ignored.
+    RemovalStats RemoveDocuments(const std::vector<int>& document_ids);
+    // Rewrites the posting lists of different terms on all cores
+    RemovalStats RemoveDocuments(std::execution::parallel_policy policy, const std::vector<int>& document_ids);
+
+    // Writes the whole index without removed documents to a file that LoadSnapshot can map.
+    // The file is replaced atomically, so servers mapping an earlier snapshot at the same
+    // path, this one included, keep serving it.
+    void SaveSnapshot(const std::string& path) const;
+
+    // Maps a snapshot and serves terms, postings and document data straight from the
+    // mapped pages; only what is modified later gets copied to the heap
+    static SearchServer LoadSnapshot(const std::string& path);
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
-    };
-    const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
+    const StopWordSet stop_words_;
+    TermDictionary terms_;
+    // indexed by TermId
+    std::vector<PostingList> term_to_document_freqs_;
+    InverseDocumentFreqTable inverse_document_freqs_;
+    // document columns indexed by DocumentOrdinal; a removed document keeps its slot until
+    // CompactOrdinals
+    MappedArray<int> document_ids_;
+    MappedArray<int> document_ratings_;
+    MappedArray<DocumentStatus> document_statuses_;
+    MappedArray<uint64_t> document_fingerprints_;
+    // sorted TermIds of every document and their term frequencies
+    std::vector<MappedArray<TermId>> document_terms_;
+    std::vector<MappedArray<double>> document_term_freqs_;
+    std::map<int, DocumentOrdinal> documents_;
     std::set<int> ids_;
-    std::map<int, std::map<std::string_view, double>> id_to_string_freq_;
-    std::map<int, std::set<std::string_view>> id_words;
+    // keeps the mapping behind the views above alive when loaded from a snapshot
+    std::shared_ptr<const MappedFile> snapshot_;
+    // document bitmaps of frequent minus words by TermId
+    mutable BitmapCache minus_word_bitmaps_;
+    mutable QueryResultCache query_results_;
+    size_t max_result_document_count_ = MAX_RESULT_DOCUMENT_COUNT;
+    size_t query_partition_count_ = std::max(1u, std::thread::hardware_concurrency());
+    bool reject_duplicates_ = false;
+    // ordinals of the live documents by fingerprint while duplicates are rejected
+    std::unordered_multimap<uint64_t, DocumentOrdinal> fingerprint_index_;
+    size_t rejected_duplicate_count_ = 0;
 
     struct QueryWord {
         std::string_view data;
@@ -80,29 +251,99 @@ private:
         bool is_stop;
     };
 
+    // Words missing from terms_ cannot match any document and are dropped
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
     };
 
     static bool IsValidWord(std::string_view word);
 
     bool IsStopWord(std::string_view word) const;
 
-    void IsValidQueryWord(std::string_view word) const;
+    // Throws on an empty or double minus word; looks for control characters only if
+    // check_characters is set, since the tokenizer reports them for the whole query
+    static void IsValidQueryWord(std::string_view word, bool check_characters);
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+    // Fills words, reusing its capacity, and throws on an invalid word
+    void SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    // Tokenizes and validates the documents without modifying the server, so it may run
+    // on several threads at once; the result refers to the documents' text
+    PartialIndex IndexDocuments(std::vector<NewDocument>::const_iterator first,
+                                std::vector<NewDocument>::const_iterator last) const;
+
+    // The live documents not in removed_ids with their postings; the result refers to terms_
+    PartialIndex ExportDocuments(const std::unordered_set<int>* removed_ids) const;
+
+    // Partial indexes must cover consecutive slices of one batch, in order
+    void MergePartialIndexes(const std::vector<PartialIndex>& partials);
+
     QueryWord ParseQueryWord(std::string_view& text) const;
 
     Query ParseQuery(std::string_view text, bool need_unique) const;
  
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    // Served from inverse_document_freqs_ while the document count stays the same
+    double ComputeWordInverseDocumentFreq(TermId term) const;
+
+    bool DocumentHasTerm(DocumentOrdinal ordinal, TermId term) const;
+
+    void ForgetFingerprint(DocumentOrdinal ordinal);
+
+    // The posting lists of the document's terms are updated under the policy, the rest in turn
+    template <typename Execution>
+    void RemoveSingleDocument(Execution policy, int document_id);
+
+    template <typename Execution>
+    RemovalStats RemoveDocumentBatch(Execution policy, const std::vector<int>& document_ids);
+
+    // Drops words that no document uses any more, so removed text does not pin memory
+    void RetireUnusedTerms(const MappedArray<TermId>& terms);
+
+    // Renumbers the live documents densely once removals leave enough ordinals unused
+    void CompactOrdinalsIfSparse();
+    void CompactOrdinals();
+
+    // Zero for plus terms without live postings
+    std::vector<double> ComputeInverseDocumentFreqs(const Query& query) const;
+
+    bool IsFrequentMinusWord(TermId term) const;
+
+    // Bitmaps of the query's frequent minus words
+    std::vector<std::shared_ptr<const DocumentBitmap>> GetMinusWordBitmaps(const Query& query) const;
+
+    // Scores the documents with ordinals in [first, last) in the calling thread's accumulator,
+    // checking a set deadline once per posting
+    template <typename Predictor>
+    TopDocumentsCollector FindDocumentsInRange(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                               const std::vector<std::shared_ptr<const DocumentBitmap>>& minus_bitmaps,
+                                               const Predictor& filter, DocumentOrdinal first, DocumentOrdinal last,
+                                               QueryDeadline deadline = QueryDeadline()) const;
+
+    // MaxScore evaluation of the same range: plus terms are ordered by their score bound, and
+    // terms whose bounds together stay below the top's entry relevance only score candidates
+    // found in the others, after block maxima have not ruled the candidate out
+    template <typename Predictor>
+    TopDocumentsCollector FindDocumentsInRangePruned(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                                     const std::vector<std::shared_ptr<const DocumentBitmap>>& minus_bitmaps,
+                                                     const Predictor& filter, DocumentOrdinal first, DocumentOrdinal last) const;
+
+    // Scores the queries over ordinal tiles: every posting list of a term of the batch keeps
+    // one cursor across tiles and adds to the accumulators of all queries containing it
+    std::vector<std::vector<Document>> FindAllDocumentsBatch(const std::vector<Query>& queries, DocumentStatus status) const;
+
+    // Serves status queries from query_results_; search() computes the result on a miss
+    template <typename Search>
+    std::vector<Document> FindCachedTopDocuments(const Query& query, DocumentStatus status, Search search) const;
+
+    // Returns the max_result_document_count_ most relevant matches, most relevant first
+    template <typename Predictor>
+    std::vector<Document> FindAllDocuments(const Query& query, Predictor filter, QueryDeadline deadline = QueryDeadline()) const;
 
     template <typename Predictor>
-    std::vector<Document> FindAllDocuments(const Query& query, Predictor filter) const;
+    std::vector<Document> FindAllDocuments(QueryEvaluation evaluation, const Query& query, Predictor filter) const;
 
     template <typename Predictor>
     std::vector<Document> FindAllDocuments(std::execution::sequenced_policy policy, const Query& query, Predictor filter) const; 
@@ -113,63 +354,208 @@ private:
 
 template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer& stop_words)
-        : stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
-
-        if(!(all_of(stop_words.begin(), stop_words.end(), IsValidWord))){
-            throw std::invalid_argument("stop words contain unavailable characters");
-        }
+        : SearchServer(StopWordSet(stop_words)) {
     }
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
                                       DocumentPredicate document_predicate) const {
     const Query query = ParseQuery(raw_query, true);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-    sort(matched_documents.begin(), matched_documents.end(),
-            [](const Document& lhs, const Document& rhs) {
-                if (std::abs(lhs.relevance - rhs.relevance) < CORRECTION) {
-                    return lhs.rating > rhs.rating;
-                } else {
-                    return lhs.relevance > rhs.relevance;
-                }
-            });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    return FindAllDocuments(query, document_predicate);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(QueryEvaluation evaluation, std::string_view raw_query,
+                                                     DocumentPredicate document_predicate) const {
+    const Query query = ParseQuery(raw_query, true);
+    return FindAllDocuments(evaluation, query, document_predicate);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const CollectionStatistics& statistics,
+                                                     DocumentPredicate document_predicate) const {
+    const Query query = ParseQuery(raw_query, true);
+    std::vector<double> inverse_document_freqs(query.plus_terms.size(), 0.0);
+    for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+        const auto it = statistics.document_freqs.find(terms_.GetTerm(query.plus_terms[i]));
+        if (it != statistics.document_freqs.end() && it->second > 0) {
+            inverse_document_freqs[i] = std::log(statistics.document_count * 1.0 / it->second);
+        }
     }
-    return matched_documents;
+    const DocumentOrdinal ordinal_count = static_cast<DocumentOrdinal>(document_ids_.size());
+    return FindDocumentsInRange(query, inverse_document_freqs, GetMinusWordBitmaps(query), document_predicate,
+                                0, ordinal_count).Extract();
 }
 
 template <typename Predictor>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, Predictor filter) const {
-    std::map<int, double> document_to_relevance;
+TopDocumentsCollector SearchServer::FindDocumentsInRange(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                                         const std::vector<std::shared_ptr<const DocumentBitmap>>& minus_bitmaps,
+                                                         const Predictor& filter, DocumentOrdinal first, DocumentOrdinal last,
+                                                         QueryDeadline deadline) const {
+    ScoreAccumulator& accumulator = GetThreadScoreAccumulator();
+    accumulator.Reset(document_ids_.size());
+    // runs once per document, so a document in a frequent minus word is rejected before any scoring
+    const auto accepts = [&](DocumentOrdinal ordinal) {
+        return std::none_of(minus_bitmaps.begin(), minus_bitmaps.end(),
+                            [ordinal](const auto& bitmap) { return bitmap->Contains(ordinal); })
+            && filter(document_ids_[ordinal], document_statuses_[ordinal], document_ratings_[ordinal]);
+    };
 
-    for (auto word : query.plus_words) {
-        if (word_to_document_freqs_.count(static_cast<std::string>(word)) == 0) {
-            continue;
+    // instantiated without the deadline check for queries that have none, so they keep the
+    // plain posting loops
+    const auto score = [&](auto check_deadline) {
+        // documents of rare minus words are excluded up front, so their postings are skipped below
+        for (const TermId term : query.minus_terms) {
+            if (!IsFrequentMinusWord(term)) {
+                term_to_document_freqs_[term].ForEachInRange(first, last, [&](DocumentOrdinal ordinal, double) {
+                    check_deadline();
+                    accumulator.Exclude(ordinal);
+                });
+            }
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(static_cast<std::string>(word));
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(static_cast<std::string>(word))) {
-            if (filter(document_id, documents_.at(document_id).status, documents_.at(document_id).rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+
+        for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+            const auto& postings = term_to_document_freqs_[query.plus_terms[i]];
+            if (postings.IsEmpty()) {
+                continue;
             }
+            const double inverse_document_freq = inverse_document_freqs[i];
+            postings.ForEachInRange(first, last, [&](DocumentOrdinal ordinal, double term_freq) {
+                check_deadline();
+                accumulator.Add(ordinal, term_freq * inverse_document_freq, accepts);
+            });
         }
+    };
+    if (deadline.IsSet()) {
+        score([&deadline] { deadline.Check(); });
+    } else {
+        score([] {});
     }
 
-    for (auto word : query.minus_words) {
-        if (word_to_document_freqs_.count(static_cast<std::string>(word)) == 0) {
+    TopDocumentsCollector top_documents(max_result_document_count_);
+    accumulator.ForEachScored([&](DocumentOrdinal ordinal, double relevance) {
+        top_documents.Add({ document_ids_[ordinal], relevance, document_ratings_[ordinal] });
+    });
+    return top_documents;
+}
+
+template <typename Predictor>
+TopDocumentsCollector SearchServer::FindDocumentsInRangePruned(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                                               const std::vector<std::shared_ptr<const DocumentBitmap>>& minus_bitmaps,
+                                                               const Predictor& filter, DocumentOrdinal first, DocumentOrdinal last) const {
+    struct TermCursor {
+        // position in query.plus_terms
+        size_t index;
+        double inverse_document_freq;
+        double max_score;
+        PostingList::Cursor cursor;
+    };
+    std::vector<TermCursor> terms;
+    for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+        const auto& postings = term_to_document_freqs_[query.plus_terms[i]];
+        if (postings.IsEmpty()) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(static_cast<std::string>(word))) {
-            document_to_relevance.erase(document_id);
+        const double inverse_document_freq = inverse_document_freqs[i];
+        terms.push_back({i, inverse_document_freq, inverse_document_freq * postings.GetMaxTermFreq(), PostingList::Cursor(postings)});
+        terms.back().cursor.Advance(first);
+    }
+    std::sort(terms.begin(), terms.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+        return lhs.max_score < rhs.max_score;
+    });
+    // bound of the score a document gets from terms [0, i]
+    std::vector<double> max_score_sums(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i) {
+        max_score_sums[i] = (i > 0 ? max_score_sums[i - 1] : 0.0) + terms[i].max_score;
+    }
+    std::vector<PostingList::Cursor> minus_cursors;
+    for (const TermId term : query.minus_terms) {
+        if (!IsFrequentMinusWord(term)) {
+            minus_cursors.emplace_back(term_to_document_freqs_[term]);
+            minus_cursors.back().Advance(first);
+        }
+    }
+    const auto is_excluded = [&](DocumentOrdinal ordinal) {
+        return std::any_of(minus_bitmaps.begin(), minus_bitmaps.end(),
+                           [ordinal](const auto& bitmap) { return bitmap->Contains(ordinal); })
+            || std::any_of(minus_cursors.begin(), minus_cursors.end(), [ordinal](PostingList::Cursor& cursor) {
+                   cursor.Advance(ordinal);
+                   return cursor.GetOrdinal() == ordinal;
+               });
+    };
+
+    TopDocumentsCollector top_documents(max_result_document_count_);
+    // indexed like query.plus_terms, so the relevance is summed in the exhaustive order
+    std::vector<double> term_scores(query.plus_terms.size(), 0.0);
+    // terms [0, essential_begin) can not lift a document into the top on their own
+    size_t essential_begin = 0;
+    while (true) {
+        // one more CORRECTION absorbs rounding differences between bounds and relevances
+        const double min_relevance = top_documents.GetMinRelevance() - CORRECTION;
+        while (essential_begin < terms.size() && max_score_sums[essential_begin] < min_relevance) {
+            ++essential_begin;
+        }
+        DocumentOrdinal candidate = PostingList::Cursor::END;
+        for (size_t i = essential_begin; i < terms.size(); ++i) {
+            candidate = std::min(candidate, terms[i].cursor.GetOrdinal());
+        }
+        if (candidate >= last) {
+            break;
+        }
+
+        double bound = essential_begin > 0 ? max_score_sums[essential_begin - 1] : 0.0;
+        for (size_t i = essential_begin; i < terms.size(); ++i) {
+            TermCursor& term = terms[i];
+            if (term.cursor.GetOrdinal() == candidate) {
+                term_scores[term.index] = term.cursor.GetTermFreq() * term.inverse_document_freq;
+                bound += term_scores[term.index];
+                term.cursor.Next();
+            }
+        }
+        bool is_rejected = bound < min_relevance;
+        for (size_t i = essential_begin; i-- > 0 && !is_rejected;) {
+            TermCursor& term = terms[i];
+            bound -= term.max_score;
+            if (bound + term.cursor.GetBlockMaxTermFreq(candidate) * term.inverse_document_freq < min_relevance) {
+                is_rejected = true;
+                break;
+            }
+            term.cursor.Advance(candidate);
+            if (term.cursor.GetOrdinal() == candidate) {
+                term_scores[term.index] = term.cursor.GetTermFreq() * term.inverse_document_freq;
+                bound += term_scores[term.index];
+            }
+        }
+        if (!is_rejected && !is_excluded(candidate)
+            && filter(document_ids_[candidate], document_statuses_[candidate], document_ratings_[candidate])) {
+            double relevance = 0.0;
+            for (const double term_score : term_scores) {
+                relevance += term_score;
+            }
+            top_documents.Add({ document_ids_[candidate], relevance, document_ratings_[candidate] });
+        }
+        for (const TermCursor& term : terms) {
+            term_scores[term.index] = 0.0;
         }
     }
+    return top_documents;
+}
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
+template <typename Predictor>
+std::vector<Document> SearchServer::FindAllDocuments(QueryEvaluation evaluation, const Query& query, Predictor filter) const {
+    if (evaluation == QueryEvaluation::EXHAUSTIVE) {
+        return FindAllDocuments(query, filter);
     }
-        return matched_documents;
+    const DocumentOrdinal ordinal_count = static_cast<DocumentOrdinal>(document_ids_.size());
+    return FindDocumentsInRangePruned(query, ComputeInverseDocumentFreqs(query), GetMinusWordBitmaps(query), filter,
+                                      0, ordinal_count).Extract();
+}
+
+template <typename Predictor>
+std::vector<Document> SearchServer::FindAllDocuments(const Query& query, Predictor filter, QueryDeadline deadline) const {
+    const DocumentOrdinal ordinal_count = static_cast<DocumentOrdinal>(document_ids_.size());
+    return FindDocumentsInRange(query, ComputeInverseDocumentFreqs(query), GetMinusWordBitmaps(query), filter,
+                                0, ordinal_count, deadline).Extract();
 }
 
 template <typename Predictor>
@@ -179,64 +565,88 @@ std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_p
 
 template <typename Predictor>
 std::vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy policy, const Query& query, Predictor filter) const {
-    ConcurrentMap<int, double> document_to_relevance(7);
-    
-    std::for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(), [&](const auto& word){
-        if (word_to_document_freqs_.count(static_cast<std::string>(word)) != 0) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(static_cast<std::string>(word));
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(static_cast<std::string>(word))) {
-                if (filter(document_id, documents_.at(document_id).status, documents_.at(document_id).rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                }
-            }            
-        }    
-    });
-
-    std::for_each(std::execution::par, query.minus_words.begin(), query.minus_words.end(), [&](const auto& word){
-        if (word_to_document_freqs_.count(static_cast<std::string>(word)) != 0) {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(static_cast<std::string>(word))) {
-                document_to_relevance.Erase(document_id);
-            }
-        }        
-    });
-
-    std::vector<Document> matched_documents;
-
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-        matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
-    }
-        return matched_documents;
+    const std::vector<double> inverse_document_freqs = ComputeInverseDocumentFreqs(query);
+    const auto minus_bitmaps = GetMinusWordBitmaps(query);
+    const size_t ordinal_count = document_ids_.size();
+    std::vector<size_t> partitions(query_partition_count_);
+    std::iota(partitions.begin(), partitions.end(), 0);
+
+    // every partition scores a disjoint ordinal range of all posting lists into its own
+    // accumulator and keeps its own top K, so the only shared step is merging the tops
+    return std::transform_reduce(std::execution::par, partitions.begin(), partitions.end(),
+        TopDocumentsCollector(max_result_document_count_),
+        [](TopDocumentsCollector lhs, const TopDocumentsCollector& rhs) {
+            lhs.Merge(rhs);
+            return lhs;
+        },
+        [&](size_t partition) {
+            const auto first = static_cast<DocumentOrdinal>(ordinal_count * partition / partitions.size());
+            const auto last = static_cast<DocumentOrdinal>(ordinal_count * (partition + 1) / partitions.size());
+            return FindDocumentsInRange(query, inverse_document_freqs, minus_bitmaps, filter, first, last);
+        }).Extract();
 }
 
 template <typename Execution, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(Execution policy, std::string_view raw_query,
                                       DocumentPredicate document_predicate) const {
     const Query query = ParseQuery(raw_query, true);
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-    sort(matched_documents.begin(), matched_documents.end(),
-            [](const Document& lhs, const Document& rhs) {
-                if (std::abs(lhs.relevance - rhs.relevance) < CORRECTION) {
-                    return lhs.rating > rhs.rating;
-                } else {
-                    return lhs.relevance > rhs.relevance;
-                }
-            });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+    return FindAllDocuments(policy, query, document_predicate);
 }
 
 template <typename Execution>
 std::vector<Document> SearchServer::FindTopDocuments(Execution policy, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(
-        policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+    const Query query = ParseQuery(raw_query, true);
+    return FindCachedTopDocuments(query, status, [&] {
+        return FindAllDocuments(policy, query, [status](int document_id, DocumentStatus document_status, int rating) {
             return document_status == status;
         });
+    });
+}
+
+template <typename StringContainer>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const StringContainer& raw_queries,
+                                                                       DocumentStatus status) const {
+    std::vector<std::vector<Document>> results;
+    std::vector<QueryResultCache::Key> missed_keys;
+    std::vector<Query> missed_queries;
+    std::vector<size_t> missed_indexes;
+    for (const auto& raw_query : raw_queries) {
+        Query query = ParseQuery(raw_query, true);
+        QueryResultCache::Key key{query.plus_terms, query.minus_terms, status};
+        if (auto documents = query_results_.Find(key)) {
+            results.push_back(std::move(*documents));
+            continue;
+        }
+        results.emplace_back();
+        missed_keys.push_back(std::move(key));
+        missed_queries.push_back(std::move(query));
+        missed_indexes.push_back(results.size() - 1);
+    }
+    std::vector<std::vector<Document>> missed_results = FindAllDocumentsBatch(missed_queries, status);
+    for (size_t i = 0; i < missed_results.size(); ++i) {
+        query_results_.Insert(std::move(missed_keys[i]), missed_results[i]);
+        results[missed_indexes[i]] = std::move(missed_results[i]);
+    }
+    return results;
+}
+
+template <typename StringContainer>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const StringContainer& raw_queries) const {
+    return FindTopDocumentsBatch(raw_queries, DocumentStatus::ACTUAL);
+}
+
+template <typename Search>
+std::vector<Document> SearchServer::FindCachedTopDocuments(const Query& query, DocumentStatus status, Search search) const {
+    QueryResultCache::Key key{query.plus_terms, query.minus_terms, status};
+    if (auto documents = query_results_.Find(key)) {
+        return std::move(*documents);
+    }
+    std::vector<Document> documents = search();
+    query_results_.Insert(std::move(key), documents);
+    return documents;
 }
 
 template <typename Execution>
 std::vector<Document> SearchServer::FindTopDocuments(Execution policy, std::string_view raw_query) const {
     return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
-}
\ No newline at end of file
+}
@@ -0,0 +1,150 @@
+#include "search_worker.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "search_protocol.h"
+
+using namespace std;
+
+SearchWorker::SearchWorker(const SearchServer& search_server, string socket_path)
+    : search_server_(search_server)
+    , socket_path_(move(socket_path))
+    , listen_fd_(ListenUnixSocket(socket_path_)) {
+}
+
+SearchWorker::~SearchWorker() {
+    Stop();
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+}
+
+void SearchWorker::Serve() {
+    while (!is_stopping_) {
+        const int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            // Stop shuts the listening socket down, which fails the pending accept
+            if (is_stopping_ || errno != EINTR) {
+                break;
+            }
+            continue;
+        }
+        JoinFinishedConnections();
+        lock_guard guard(connections_mutex_);
+        if (is_stopping_) {
+            close(fd);
+            break;
+        }
+        connection_fds_.push_back(fd);
+        connections_.emplace_back([this, fd] { ServeConnection(fd); });
+    }
+    {
+        lock_guard guard(connections_mutex_);
+        for (const int fd : connection_fds_) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+    for (thread& connection : connections_) {
+        connection.join();
+    }
+    connections_.clear();
+    finished_connections_.clear();
+}
+
+void SearchWorker::Stop() {
+    is_stopping_ = true;
+    shutdown(listen_fd_, SHUT_RDWR);
+    lock_guard guard(connections_mutex_);
+    for (const int fd : connection_fds_) {
+        shutdown(fd, SHUT_RDWR);
+    }
+}
+
+void SearchWorker::ServeConnection(int fd) {
+    string request;
+    try {
+        while (ReceiveMessage(fd, request)) {
+            SendMessage(fd, Answer(request));
+        }
+    } catch (const runtime_error&) {
+        // a broken connection only ends itself
+    }
+    lock_guard guard(connections_mutex_);
+    connection_fds_.erase(find(connection_fds_.begin(), connection_fds_.end(), fd));
+    close(fd);
+    finished_connections_.push_back(this_thread::get_id());
+}
+
+void SearchWorker::JoinFinishedConnections() {
+    vector<thread::id> finished;
+    {
+        lock_guard guard(connections_mutex_);
+        finished.swap(finished_connections_);
+    }
+    // a finished thread only has to return after giving up the lock, so joining it is short
+    const auto is_finished = [&finished](const thread& connection) {
+        return find(finished.begin(), finished.end(), connection.get_id()) != finished.end();
+    };
+    for (thread& connection : connections_) {
+        if (is_finished(connection)) {
+            connection.join();
+        }
+    }
+    connections_.erase(remove_if(connections_.begin(), connections_.end(), [](const thread& connection) {
+        return !connection.joinable();
+    }), connections_.end());
+}
+
+string SearchWorker::Answer(const string& request) const {
+    try {
+        MessageReader reader(request);
+        switch (reader.GetType()) {
+        case MessageType::DOCUMENT_FREQS: {
+            MessageWriter writer(MessageType::DOCUMENT_FREQS);
+            writer.Write<int32_t>(search_server_.GetDocumentCount());
+            for (uint32_t word_count = reader.Read<uint32_t>(); word_count > 0; --word_count) {
+                writer.Write<int32_t>(search_server_.GetDocumentFreq(reader.ReadString()));
+            }
+            return writer.GetPayload();
+        }
+        case MessageType::TOP_DOCUMENTS: {
+            const string_view raw_query = reader.ReadString();
+            const auto status = static_cast<DocumentStatus>(reader.Read<uint8_t>());
+            CollectionStatistics statistics;
+            statistics.document_count = reader.Read<int32_t>();
+            for (uint32_t word_count = reader.Read<uint32_t>(); word_count > 0; --word_count) {
+                const string_view word = reader.ReadString();
+                statistics.document_freqs[word] = reader.Read<int32_t>();
+            }
+            const vector<Document> documents = search_server_.FindTopDocuments(raw_query, statistics,
+                [status](int document_id, DocumentStatus document_status, int rating) {
+                    return document_status == status;
+                });
+            MessageWriter writer(MessageType::TOP_DOCUMENTS);
+            writer.Write(static_cast<uint32_t>(documents.size()));
+            for (const Document& document : documents) {
+                writer.Write<int32_t>(document.id);
+                writer.Write<double>(document.relevance);
+                writer.Write<int32_t>(document.rating);
+            }
+            return writer.GetPayload();
+        }
+        default:
+            throw runtime_error("unknown search request");
+        }
+    } catch (const invalid_argument& error) {
+        MessageWriter writer(MessageType::ERROR);
+        writer.Write(ErrorKind::INVALID_ARGUMENT);
+        writer.WriteString(error.what());
+        return writer.GetPayload();
+    } catch (const exception& error) {
+        MessageWriter writer(MessageType::ERROR);
+        writer.Write(ErrorKind::INTERNAL);
+        writer.WriteString(error.what());
+        return writer.GetPayload();
+    }
+}
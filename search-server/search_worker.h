@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+// Serves one partition of a distributed collection to SearchCoordinators over a Unix
+// domain socket: it reports the document frequencies of query words and ranks its own
+// documents with the frequencies of the whole collection. The server must outlive the
+// worker and must not be modified while it serves.
+class SearchWorker {
+public:
+    // Starts listening at once, so coordinators may connect before Serve is called
+    SearchWorker(const SearchServer& search_server, std::string socket_path);
+
+    // Stops serving and removes the socket file
+    ~SearchWorker();
+
+    SearchWorker(const SearchWorker&) = delete;
+    SearchWorker& operator=(const SearchWorker&) = delete;
+
+    // Answers every connection on its own thread until Stop is called
+    void Serve();
+
+    // Makes Serve return once the open connections are closed; safe to call from any thread
+    void Stop();
+
+private:
+    const SearchServer& search_server_;
+    const std::string socket_path_;
+    int listen_fd_ = -1;
+    std::atomic<bool> is_stopping_ = false;
+    std::mutex connections_mutex_;
+    std::vector<int> connection_fds_;
+    std::vector<std::thread> connections_;
+    // Connections whose threads ended but were not joined yet
+    std::vector<std::thread::id> finished_connections_;
+
+    void ServeConnection(int fd);
+
+    // Joins the threads of closed connections, so a long-lived worker keeps only open ones
+    void JoinFinishedConnections();
+
+    std::string Answer(const std::string& request) const;
+};
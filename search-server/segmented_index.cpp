@@ -0,0 +1,83 @@
+#include "segmented_index.h"
+
+#include <stdexcept>
+
+#include "string_processing.h"
+
+using namespace std;
+
+void SegmentDeletes::Add(const SearchServer& index, int document_id) {
+    document_ids.insert(document_id);
+    removed_ids.push_back(document_id);
+    for (const string_view word : index.GetWordsById(document_id)) {
+        ++document_freqs[word];
+    }
+}
+
+bool SegmentDeletes::Contains(int document_id) const {
+    return document_ids.count(document_id) > 0;
+}
+
+int SegmentedIndex::Segment::GetDocumentCount() const {
+    return index->GetDocumentCount() - (deletes ? static_cast<int>(deletes->removed_ids.size()) : 0);
+}
+
+bool SegmentedIndex::Segment::IsLive(int document_id) const {
+    return index->ContainsDocument(document_id) && (!deletes || !deletes->Contains(document_id));
+}
+
+SegmentedIndex::SegmentedIndex(vector<Segment> segments, size_t max_result_document_count)
+    : segments_(move(segments))
+    , max_result_document_count_(max_result_document_count) {
+}
+
+vector<Document> SegmentedIndex::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(execution::seq, raw_query, status);
+}
+
+vector<Document> SegmentedIndex::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+words_docstatus SegmentedIndex::MatchDocument(string_view raw_query, int document_id) const {
+    for (const Segment& segment : segments_) {
+        if (segment.IsLive(document_id)) {
+            return segment.index->MatchDocument(raw_query, document_id);
+        }
+    }
+    throw out_of_range("");
+}
+
+int SegmentedIndex::GetDocumentCount() const {
+    int document_count = 0;
+    for (const Segment& segment : segments_) {
+        document_count += segment.GetDocumentCount();
+    }
+    return document_count;
+}
+
+const vector<SegmentedIndex::Segment>& SegmentedIndex::GetSegments() const {
+    return segments_;
+}
+
+CollectionStatistics SegmentedIndex::ComputeStatistics(string_view raw_query) const {
+    CollectionStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    for (const string_view word : SplitIntoWords(raw_query)) {
+        // minus words only exclude, and stop words and invalid words are left to the segments
+        if (word.empty() || word[0] == '-' || statistics.document_freqs.count(word)) {
+            continue;
+        }
+        int& document_freq = statistics.document_freqs[word];
+        for (const Segment& segment : segments_) {
+            document_freq += segment.index->GetDocumentFreq(word);
+            if (segment.deletes) {
+                const auto it = segment.deletes->document_freqs.find(word);
+                if (it != segment.deletes->document_freqs.end()) {
+                    document_freq -= it->second;
+                }
+            }
+        }
+    }
+    return statistics;
+}
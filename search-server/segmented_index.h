@@ -0,0 +1,129 @@
+#pragma once
+
+#include <execution>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "document.h"
+#include "parallel_for.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+// Documents removed from a segment after it was sealed
+struct SegmentDeletes {
+    // hashed, so copying the deletes of a published segment costs the removals and not the
+    // range of the ids
+    std::unordered_set<int> document_ids;
+    // in the order of removal
+    std::vector<int> removed_ids;
+    // removed documents containing each word; views into the segment's terms
+    std::map<std::string_view, int> document_freqs;
+
+    // The document must be live in the index
+    void Add(const SearchServer& index, int document_id);
+
+    bool Contains(int document_id) const;
+};
+
+// An immutable index made of segments that each hold different documents. Queries rank
+// every segment with the document frequencies of the whole index, so merging the top
+// documents of the segments gives the top of the whole index.
+class SegmentedIndex {
+public:
+    struct Segment {
+        std::shared_ptr<const SearchServer> index;
+        // null while nothing is removed
+        std::shared_ptr<const SegmentDeletes> deletes;
+
+        int GetDocumentCount() const;
+
+        bool IsLive(int document_id) const;
+    };
+
+    SegmentedIndex(std::vector<Segment> segments, size_t max_result_document_count);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    // Segments are searched in parallel under std::execution::par
+    template <typename Execution, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(Execution policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
+    template <typename Execution>
+    std::vector<Document> FindTopDocuments(Execution policy, std::string_view raw_query, DocumentStatus status) const;
+    template <typename Execution>
+    std::vector<Document> FindTopDocuments(Execution policy, std::string_view raw_query) const;
+
+    // Returned words view the segment holding the document
+    words_docstatus MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    const std::vector<Segment>& GetSegments() const;
+
+private:
+    std::vector<Segment> segments_;
+    size_t max_result_document_count_;
+
+    // Live documents and document frequencies of the query's plus words over all segments
+    CollectionStatistics ComputeStatistics(std::string_view raw_query) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedIndex::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename Execution, typename DocumentPredicate>
+std::vector<Document> SegmentedIndex::FindTopDocuments(Execution policy, std::string_view raw_query,
+                                                       DocumentPredicate document_predicate) const {
+    // every segment would reject an invalid query; without segments none would
+    SearchServer::ValidateQuery(raw_query);
+    const CollectionStatistics statistics = ComputeStatistics(raw_query);
+    std::vector<TopDocumentsCollector> segment_tops(segments_.size(), TopDocumentsCollector(max_result_document_count_));
+    const auto search_segment = [&](size_t index) {
+        const Segment& segment = segments_[index];
+        const auto documents = segment.index->FindTopDocuments(raw_query, statistics,
+            [&](int document_id, DocumentStatus status, int rating) {
+                return (!segment.deletes || !segment.deletes->Contains(document_id))
+                    && document_predicate(document_id, status, rating);
+            });
+        for (const Document& document : documents) {
+            segment_tops[index].Add(document);
+        }
+    };
+    if constexpr (std::is_same_v<std::decay_t<Execution>, std::execution::parallel_policy>) {
+        // an exception escaping a parallel algorithm would terminate instead of reaching the caller
+        ParallelForSlices(segments_.size(), segments_.size(), [&](size_t, size_t first, size_t last) {
+            for (size_t index = first; index < last; ++index) {
+                search_segment(index);
+            }
+        });
+    } else {
+        for (size_t index = 0; index < segments_.size(); ++index) {
+            search_segment(index);
+        }
+    }
+
+    TopDocumentsCollector top_documents(max_result_document_count_);
+    for (const TopDocumentsCollector& segment_top : segment_tops) {
+        top_documents.Merge(segment_top);
+    }
+    return top_documents.Extract();
+}
+
+template <typename Execution>
+std::vector<Document> SegmentedIndex::FindTopDocuments(Execution policy, std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    });
+}
+
+template <typename Execution>
+std::vector<Document> SegmentedIndex::FindTopDocuments(Execution policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
@@ -0,0 +1,189 @@
+#include "sharded_search_server.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+#include "string_processing.h"
+
+using namespace std;
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const SearchServer& prototype) {
+    if (shard_count == 0) {
+        throw invalid_argument("a sharded server needs at least one shard");
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(prototype.CloneEmpty());
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    GetDocumentShard(document_id).AddDocument(document_id, document, status, ratings);
+    ids_.insert(document_id);
+}
+
+void ShardedSearchServer::AddDocuments(const vector<NewDocument>& documents) {
+    vector<vector<NewDocument>> shard_documents(shards_.size());
+    for (const NewDocument& document : documents) {
+        shard_documents[GetShardIndex(document.id)].push_back(document);
+    }
+    // every shard adds its part or none of it, so a failed batch is undone by removing the
+    // parts of the shards that succeeded
+    vector<char> is_added(shards_.size(), false);
+    try {
+        ParallelForSlices(shards_.size(), shards_.size(), [&](size_t shard, size_t, size_t) {
+            shards_[shard].AddDocuments(shard_documents[shard]);
+            is_added[shard] = true;
+        });
+    } catch (...) {
+        for (size_t shard = 0; shard < shards_.size(); ++shard) {
+            if (!is_added[shard]) {
+                continue;
+            }
+            vector<int> document_ids;
+            for (const NewDocument& document : shard_documents[shard]) {
+                document_ids.push_back(document.id);
+            }
+            shards_[shard].RemoveDocuments(document_ids);
+        }
+        throw;
+    }
+    for (const NewDocument& document : documents) {
+        ids_.insert(document.id);
+    }
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(execution::seq, raw_query, status);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    return static_cast<int>(ids_.size());
+}
+
+bool ShardedSearchServer::ContainsDocument(int document_id) const {
+    return ids_.count(document_id) > 0;
+}
+
+int ShardedSearchServer::GetDocumentFreq(string_view word) const {
+    int document_freq = 0;
+    for (const SearchServer& shard : shards_) {
+        document_freq += shard.GetDocumentFreq(word);
+    }
+    return document_freq;
+}
+
+void ShardedSearchServer::SetMaxResultDocumentCount(size_t count) {
+    max_result_document_count_ = count;
+    for (SearchServer& shard : shards_) {
+        shard.SetMaxResultDocumentCount(count);
+    }
+}
+
+size_t ShardedSearchServer::GetMaxResultDocumentCount() const {
+    return max_result_document_count_;
+}
+
+words_docstatus ShardedSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    return GetDocumentShard(document_id).MatchDocument(raw_query, document_id);
+}
+
+words_docstatus ShardedSearchServer::MatchDocument(execution::sequenced_policy policy, string_view raw_query, int document_id) const {
+    return GetDocumentShard(document_id).MatchDocument(policy, raw_query, document_id);
+}
+
+words_docstatus ShardedSearchServer::MatchDocument(execution::parallel_policy policy, string_view raw_query, int document_id) const {
+    return GetDocumentShard(document_id).MatchDocument(policy, raw_query, document_id);
+}
+
+set<int>::const_iterator ShardedSearchServer::begin() const {
+    return ids_.begin();
+}
+
+set<int>::const_iterator ShardedSearchServer::end() const {
+    return ids_.end();
+}
+
+map<string_view, double> ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    return GetDocumentShard(document_id).GetWordFrequencies(document_id);
+}
+
+set<string_view> ShardedSearchServer::GetWordsById(int document_id) const {
+    return GetDocumentShard(document_id).GetWordsById(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    GetDocumentShard(document_id).RemoveDocument(document_id);
+    ids_.erase(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(execution::sequenced_policy policy, int document_id) {
+    GetDocumentShard(document_id).RemoveDocument(policy, document_id);
+    ids_.erase(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(execution::parallel_policy policy, int document_id) {
+    GetDocumentShard(document_id).RemoveDocument(policy, document_id);
+    ids_.erase(document_id);
+}
+
+RemovalStats ShardedSearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    vector<vector<int>> shard_document_ids(shards_.size());
+    for (const int document_id : document_ids) {
+        shard_document_ids[GetShardIndex(document_id)].push_back(document_id);
+    }
+    vector<RemovalStats> shard_stats(shards_.size());
+    ParallelForSlices(shards_.size(), shards_.size(), [&](size_t shard, size_t, size_t) {
+        shard_stats[shard] = shards_[shard].RemoveDocuments(shard_document_ids[shard]);
+    });
+    RemovalStats stats;
+    for (const RemovalStats& shard_stat : shard_stats) {
+        stats.removed_document_count += shard_stat.removed_document_count;
+        stats.retired_term_count += shard_stat.retired_term_count;
+        stats.reclaimed_bytes += shard_stat.reclaimed_bytes;
+    }
+    for (const int document_id : document_ids) {
+        ids_.erase(document_id);
+    }
+    return stats;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t shard) const {
+    return shards_.at(shard);
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    // Fibonacci hashing, so ids of any stride spread evenly over the shards
+    uint64_t hash = static_cast<uint32_t>(document_id) * 0x9e3779b97f4a7c15;
+    hash ^= hash >> 32;
+    return hash % shards_.size();
+}
+
+SearchServer& ShardedSearchServer::GetDocumentShard(int document_id) {
+    return shards_[GetShardIndex(document_id)];
+}
+
+const SearchServer& ShardedSearchServer::GetDocumentShard(int document_id) const {
+    return shards_[GetShardIndex(document_id)];
+}
+
+CollectionStatistics ShardedSearchServer::ComputeStatistics(string_view raw_query) const {
+    CollectionStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    for (const string_view word : SplitIntoWords(raw_query)) {
+        // minus words only exclude, and stop words and invalid words are left to the shards
+        if (word.empty() || word[0] == '-' || statistics.document_freqs.count(word)) {
+            continue;
+        }
+        statistics.document_freqs[word] = GetDocumentFreq(word);
+    }
+    return statistics;
+}
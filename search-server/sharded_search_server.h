@@ -0,0 +1,142 @@
+#pragma once
+
+#include <execution>
+#include <map>
+#include <set>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "document.h"
+#include "parallel_for.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+// Documents partitioned by a hash of their id across independent SearchServer shards, so
+// updates of different shards touch no shared index structures. Queries are scattered to
+// all shards with the document frequencies of the whole collection and the top documents
+// of the shards are merged, so results rank as one index of all documents would.
+// Everything addressed by a document id goes to its shard alone.
+class ShardedSearchServer {
+public:
+    // Every shard gets the same stop words, given as SearchServer accepts them
+    template <typename StopWords>
+    ShardedSearchServer(size_t shard_count, const StopWords& stop_words);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Adds all documents of the batch or none of them; the shards index their parts in parallel
+    void AddDocuments(const std::vector<NewDocument>& documents);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    // Shards are searched in parallel under std::execution::par
+    template <typename Execution, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(Execution policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
+    template <typename Execution>
+    std::vector<Document> FindTopDocuments(Execution policy, std::string_view raw_query, DocumentStatus status) const;
+    template <typename Execution>
+    std::vector<Document> FindTopDocuments(Execution policy, std::string_view raw_query) const;
+
+    int GetDocumentCount() const;
+
+    bool ContainsDocument(int document_id) const;
+
+    // Summed over the shards
+    int GetDocumentFreq(std::string_view word) const;
+
+    void SetMaxResultDocumentCount(size_t count);
+    size_t GetMaxResultDocumentCount() const;
+
+    // Returned words view the storage of the document's shard
+    words_docstatus MatchDocument(std::string_view raw_query, int document_id) const;
+    words_docstatus MatchDocument(std::execution::sequenced_policy policy, std::string_view raw_query, int document_id) const;
+    words_docstatus MatchDocument(std::execution::parallel_policy policy, std::string_view raw_query, int document_id) const;
+
+    std::set<int>::const_iterator begin() const;
+    std::set<int>::const_iterator end() const;
+
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    std::set<std::string_view> GetWordsById(int document_id) const;
+
+    void RemoveDocument(int document_id);
+    void RemoveDocument(std::execution::sequenced_policy policy, int document_id);
+    void RemoveDocument(std::execution::parallel_policy policy, int document_id);
+
+    // Every shard removes its part of the batch, all of them in parallel
+    RemovalStats RemoveDocuments(const std::vector<int>& document_ids);
+
+    size_t GetShardCount() const;
+    const SearchServer& GetShard(size_t shard) const;
+
+    // The shard holding document_id, whether or not it is indexed
+    size_t GetShardIndex(int document_id) const;
+
+private:
+    std::vector<SearchServer> shards_;
+    std::set<int> ids_;
+    size_t max_result_document_count_ = MAX_RESULT_DOCUMENT_COUNT;
+
+    ShardedSearchServer(size_t shard_count, const SearchServer& prototype);
+
+    SearchServer& GetDocumentShard(int document_id);
+    const SearchServer& GetDocumentShard(int document_id) const;
+
+    // Live documents and document frequencies of the query's plus words over all shards
+    CollectionStatistics ComputeStatistics(std::string_view raw_query) const;
+};
+
+template <typename StopWords>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StopWords& stop_words)
+    : ShardedSearchServer(shard_count, SearchServer(stop_words)) {
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                            DocumentPredicate document_predicate) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename Execution, typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(Execution policy, std::string_view raw_query,
+                                                            DocumentPredicate document_predicate) const {
+    const CollectionStatistics statistics = ComputeStatistics(raw_query);
+    std::vector<TopDocumentsCollector> shard_tops(shards_.size(), TopDocumentsCollector(max_result_document_count_));
+    const auto search_shard = [&](size_t shard) {
+        for (const Document& document : shards_[shard].FindTopDocuments(raw_query, statistics, document_predicate)) {
+            shard_tops[shard].Add(document);
+        }
+    };
+    if constexpr (std::is_same_v<std::decay_t<Execution>, std::execution::parallel_policy>) {
+        // rethrows an invalid query instead of terminating inside the parallel algorithm
+        ParallelForSlices(shards_.size(), shards_.size(), [&](size_t shard, size_t, size_t) {
+            search_shard(shard);
+        });
+    } else {
+        for (size_t shard = 0; shard < shards_.size(); ++shard) {
+            search_shard(shard);
+        }
+    }
+
+    TopDocumentsCollector top_documents(max_result_document_count_);
+    for (const TopDocumentsCollector& shard_top : shard_tops) {
+        top_documents.Merge(shard_top);
+    }
+    return top_documents.Extract();
+}
+
+template <typename Execution>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(Execution policy, std::string_view raw_query,
+                                                            DocumentStatus status) const {
+    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    });
+}
+
+template <typename Execution>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(Execution policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
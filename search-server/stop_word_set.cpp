@@ -0,0 +1,53 @@
+#include "stop_word_set.h"
+
+#include <algorithm>
+
+using namespace std;
+
+size_t StopWordSet::size() const {
+    return word_count_;
+}
+
+const string_view* StopWordSet::begin() const {
+    return words_;
+}
+
+const string_view* StopWordSet::end() const {
+    return words_ + word_count_;
+}
+
+void StopWordSet::Build(vector<string_view> words) {
+    words.erase(remove(words.begin(), words.end(), string_view{}), words.end());
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+
+    auto storage = make_shared<Storage>();
+    size_t char_count = 0;
+    for (const string_view word : words) {
+        char_count += word.size();
+    }
+    // reserved up front, so the views into it stay valid
+    storage->chars.reserve(char_count);
+    size_t slot_count = 2;
+    while (slot_count < words.size() * 2) {
+        slot_count *= 2;
+    }
+    storage->slots.resize(slot_count);
+    for (const string_view word : words) {
+        const string_view stored(storage->chars.data() + storage->chars.size(), word.size());
+        storage->chars.append(word);
+        storage->words.push_back(stored);
+        size_t slot = HashStopWord(stored) & (slot_count - 1);
+        while (!storage->slots[slot].empty()) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        storage->slots[slot] = stored;
+        prefilter_.Add(stored);
+    }
+
+    words_ = storage->words.data();
+    word_count_ = storage->words.size();
+    slots_ = storage->slots.data();
+    slot_mask_ = slot_count - 1;
+    storage_ = move(storage);
+}
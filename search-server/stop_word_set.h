@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Words longer than this share the last bit of the length prefilter
+const size_t MAX_PREFILTERED_STOP_WORD_LENGTH = 63;
+
+// FNV-1a, usable at compile time
+constexpr uint64_t HashStopWord(std::string_view word) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (const char c : word) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash ^ (hash >> 32);
+}
+
+// Lengths and first characters present among the stop words, one bit each, which turn
+// most other words away before hashing
+struct StopWordPrefilter {
+    uint64_t lengths = 0;
+    std::array<uint64_t, 4> first_chars = {};
+
+    constexpr void Add(std::string_view word) {
+        const auto first_char = static_cast<unsigned char>(word[0]);
+        lengths |= uint64_t{1} << (word.size() < MAX_PREFILTERED_STOP_WORD_LENGTH ? word.size() : MAX_PREFILTERED_STOP_WORD_LENGTH);
+        first_chars[first_char >> 6] |= uint64_t{1} << (first_char & 63);
+    }
+
+    constexpr bool MayContain(std::string_view word) const {
+        const auto first_char = static_cast<unsigned char>(word[0]);
+        return (lengths >> (word.size() < MAX_PREFILTERED_STOP_WORD_LENGTH ? word.size() : MAX_PREFILTERED_STOP_WORD_LENGTH) & 1)
+            && (first_chars[first_char >> 6] >> (first_char & 63) & 1);
+    }
+};
+
+// Open-addressing table of distinct non-empty words built at compile time by
+// MakeStopWordTable; an empty view marks a free slot
+template <size_t WordCount>
+struct StaticStopWordTable {
+    // a power of two at least twice the word count keeps probe sequences short
+    static constexpr size_t SLOT_COUNT = [] {
+        size_t slot_count = 2;
+        while (slot_count < WordCount * 2) {
+            slot_count *= 2;
+        }
+        return slot_count;
+    }();
+
+    std::array<std::string_view, WordCount> words;
+    std::array<std::string_view, SLOT_COUNT> slots;
+    StopWordPrefilter prefilter;
+};
+
+template <size_t WordCount>
+constexpr StaticStopWordTable<WordCount> MakeStopWordTable(const std::array<std::string_view, WordCount>& words) {
+    using Table = StaticStopWordTable<WordCount>;
+    Table table{words, {}, {}};
+    for (const std::string_view word : words) {
+        // also catches an array declared longer than its initializer list
+        if (word.empty()) {
+            throw std::invalid_argument("stop words must not be empty");
+        }
+        size_t slot = HashStopWord(word) & (Table::SLOT_COUNT - 1);
+        while (!table.slots[slot].empty() && table.slots[slot] != word) {
+            slot = (slot + 1) & (Table::SLOT_COUNT - 1);
+        }
+        table.slots[slot] = word;
+        table.prefilter.Add(word);
+    }
+    return table;
+}
+
+// Set of stop words compiled into an open-addressing hash table behind a prefilter on the
+// word length and first character. Copies share the table, which never changes.
+class StopWordSet {
+public:
+    StopWordSet() = default;
+
+    // Copies the distinct non-empty words
+    template <typename StringContainer>
+    explicit StopWordSet(const StringContainer& words);
+
+    // Looks words up in a table built at compile time without copying it, so the table
+    // must outlive the set
+    template <size_t WordCount>
+    explicit StopWordSet(const StaticStopWordTable<WordCount>& table)
+        : words_(table.words.data())
+        , word_count_(WordCount)
+        , slots_(table.slots.data())
+        , slot_mask_(StaticStopWordTable<WordCount>::SLOT_COUNT - 1)
+        , prefilter_(table.prefilter) {
+    }
+
+    bool Contains(std::string_view word) const {
+        if (word.empty() || !prefilter_.MayContain(word)) {
+            return false;
+        }
+        for (size_t slot = HashStopWord(word) & slot_mask_;; slot = (slot + 1) & slot_mask_) {
+            if (slots_[slot] == word) {
+                return true;
+            }
+            if (slots_[slot].empty()) {
+                return false;
+            }
+        }
+    }
+
+    size_t size() const;
+
+    // The words in no particular order
+    const std::string_view* begin() const;
+    const std::string_view* end() const;
+
+private:
+    struct Storage {
+        std::string chars;
+        std::vector<std::string_view> words;
+        std::vector<std::string_view> slots;
+    };
+
+    std::shared_ptr<const Storage> storage_;
+    const std::string_view* words_ = nullptr;
+    size_t word_count_ = 0;
+    const std::string_view* slots_ = nullptr;
+    size_t slot_mask_ = 0;
+    StopWordPrefilter prefilter_;
+
+    void Build(std::vector<std::string_view> words);
+};
+
+template <typename StringContainer>
+StopWordSet::StopWordSet(const StringContainer& words) {
+    std::vector<std::string_view> views;
+    for (const auto& word : words) {
+        views.push_back(std::string_view(word));
+    }
+    Build(std::move(views));
+}
+
+// A common English stop list, hashed at compile time
+inline constexpr auto ENGLISH_STOP_WORDS = MakeStopWordTable(std::array<std::string_view, 126>{
+    "a", "about", "above", "after", "again", "against", "all", "am", "an", "and", "any", "are", "as", "at",
+    "be", "because", "been", "before", "being", "below", "between", "both", "but", "by",
+    "can", "could", "did", "do", "does", "doing", "down", "during", "each", "few", "for", "from", "further",
+    "had", "has", "have", "having", "he", "her", "here", "hers", "herself", "him", "himself", "his", "how",
+    "i", "if", "in", "into", "is", "it", "its", "itself", "just", "me", "more", "most", "my", "myself",
+    "no", "nor", "not", "now", "of", "off", "on", "once", "only", "or", "other", "our", "ours", "ourselves",
+    "out", "over", "own", "same", "she", "should", "so", "some", "such", "than", "that", "the", "their",
+    "theirs", "them", "themselves", "then", "there", "these", "they", "this", "those", "through", "to", "too",
+    "under", "until", "up", "very", "was", "we", "were", "what", "when", "where", "which", "while", "who",
+    "whom", "why", "will", "with", "would", "you", "your", "yours", "yourself", "yourselves",
+});
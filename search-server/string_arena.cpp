@@ -0,0 +1,75 @@
+#include "string_arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+using namespace std;
+
+StringArena::StringArena(size_t chunk_size)
+    : chunk_size_(chunk_size) {
+}
+
+StringArena::StringArena(StringArena&& other) noexcept
+    : chunk_size_(other.chunk_size_) {
+    *this = move(other);
+}
+
+StringArena& StringArena::operator=(StringArena&& other) noexcept {
+    if (this != &other) {
+        chunk_size_ = other.chunk_size_;
+        chunks_ = move(other.chunks_);
+        current_chunk_ = exchange(other.current_chunk_, nullptr);
+        chunk_free_ = exchange(other.chunk_free_, 0);
+        chunk_position_ = exchange(other.chunk_position_, nullptr);
+        used_bytes_ = exchange(other.used_bytes_, 0);
+        allocated_bytes_ = exchange(other.allocated_bytes_, 0);
+        other.chunks_.clear();
+    }
+    return *this;
+}
+
+string_view StringArena::Store(string_view str) {
+    if (str.empty()) {
+        return {};
+    }
+    if (str.size() > chunk_free_) {
+        // an oversized string gets a chunk of its own
+        const size_t size = max(chunk_size_, str.size());
+        auto data = make_unique<char[]>(size);
+        chunk_position_ = data.get();
+        current_chunk_ = data.get();
+        chunks_.emplace(current_chunk_, Chunk{move(data), size, 0});
+        chunk_free_ = size;
+        allocated_bytes_ += size;
+    }
+    char* stored = chunk_position_;
+    memcpy(stored, str.data(), str.size());
+    chunk_position_ += str.size();
+    chunk_free_ -= str.size();
+    used_bytes_ += str.size();
+    chunks_.at(current_chunk_).used_bytes += str.size();
+    return {stored, str.size()};
+}
+
+void StringArena::Release(string_view str) {
+    if (str.empty()) {
+        return;
+    }
+    auto it = prev(chunks_.upper_bound(str.data()));
+    Chunk& chunk = it->second;
+    chunk.used_bytes -= str.size();
+    used_bytes_ -= str.size();
+    if (chunk.used_bytes == 0 && it->first != current_chunk_) {
+        allocated_bytes_ -= chunk.size;
+        chunks_.erase(it);
+    }
+}
+
+size_t StringArena::GetUsedBytes() const {
+    return used_bytes_;
+}
+
+size_t StringArena::GetMemoryUsage() const {
+    return allocated_bytes_;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string_view>
+
+// Bump allocator for strings: copies are packed into large chunks, so storing a string
+// costs no heap allocation of its own. Stored views stay valid until they are released
+// or the arena is destroyed; a chunk is freed once all strings stored in it are released.
+class StringArena {
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit StringArena(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    // The moved-from arena is left empty
+    StringArena(StringArena&& other) noexcept;
+    StringArena& operator=(StringArena&& other) noexcept;
+
+    std::string_view Store(std::string_view str);
+
+    // Gives back a view returned by Store; other views into its chunk stay valid
+    void Release(std::string_view str);
+
+    // Bytes taken by stored strings not yet released
+    size_t GetUsedBytes() const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+        size_t used_bytes;
+    };
+
+    size_t chunk_size_;
+    // by start address, so a view finds its chunk
+    std::map<const char*, Chunk> chunks_;
+    // the chunk being filled, kept even while none of its strings is live
+    const char* current_chunk_ = nullptr;
+    size_t chunk_free_ = 0;
+    char* chunk_position_ = nullptr;
+    size_t used_bytes_ = 0;
+    size_t allocated_bytes_ = 0;
+};
@@ -1,30 +1,211 @@
 #include "string_processing.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STRING_PROCESSING_X86
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
+namespace {
+
+// Bytes described by one mask, bit i standing for byte i
+const size_t BLOCK_SIZE = 32;
+
+size_t CountTrailingZeros(uint32_t value) {
+#ifdef __GNUC__
+    return __builtin_ctz(value);
+#else
+    size_t count = 0;
+    for (; (value & 1) == 0; value >>= 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// Turns masks of spaces into word spans
+class WordCollector {
+public:
+    WordCollector(string_view text, vector<string_view>& words)
+        : text_(text)
+        , words_(words) {
+        words_.clear();
+    }
+
+    void operator()(size_t offset, uint32_t spaces) {
+        // a block ends at most BLOCK_SIZE / 2 words, so they are stored without capacity checks
+        if (word_count_ + BLOCK_SIZE / 2 > words_.size()) {
+            words_.resize(max(words_.size() * 2, word_count_ + BLOCK_SIZE));
+        }
+        const uint32_t letters = ~spaces;
+        const uint32_t previous_letters = (letters << 1) | previous_letter_;
+        previous_letter_ = letters >> (BLOCK_SIZE - 1);
+        uint32_t starts = letters & ~previous_letters;
+        // bits of the spaces right after words
+        uint32_t ends = ~letters & previous_letters;
+        if (is_in_word_ && ends != 0) {
+            AddWord(word_start_, offset + CountTrailingZeros(ends));
+            ends &= ends - 1;
+            is_in_word_ = false;
+        }
+        // every other end has its start in the block
+        for (; ends != 0; ends &= ends - 1, starts &= starts - 1) {
+            AddWord(offset + CountTrailingZeros(starts), offset + CountTrailingZeros(ends));
+        }
+        if (starts != 0) {
+            word_start_ = offset + CountTrailingZeros(starts);
+            is_in_word_ = true;
+        }
+    }
+
+    void Finish() {
+        words_.resize(word_count_);
+        if (is_in_word_) {
+            words_.push_back(text_.substr(word_start_));
+        }
+    }
+
+private:
+    string_view text_;
+    vector<string_view>& words_;
+
+    void AddWord(size_t start, size_t end) {
+        words_[word_count_++] = string_view(text_.data() + start, end - start);
+    }
+
+    size_t word_count_ = 0;
+    uint32_t previous_letter_ = 0;
+    bool is_in_word_ = false;
+    size_t word_start_ = 0;
+};
+
+// Mask of the spaces among up to BLOCK_SIZE bytes, the missing ones counted as spaces
+uint32_t ScanBlockScalar(const char* bytes, size_t size, bool& has_control) {
+    uint32_t spaces = size < BLOCK_SIZE ? ~uint32_t{0} << size : 0;
+    for (size_t i = 0; i < size; ++i) {
+        spaces |= static_cast<uint32_t>(bytes[i] == ' ') << i;
+        has_control |= static_cast<unsigned char>(bytes[i]) < ' ';
+    }
+    return spaces;
+}
+
+// Every ScanBlocks passes the space mask of each block to handle_block and
+// returns whether text contains a control character
+template <typename BlockHandler>
+bool ScanBlocksScalar(string_view text, BlockHandler& handle_block) {
+    bool has_control = false;
+    for (size_t offset = 0; offset < text.size(); offset += BLOCK_SIZE) {
+        handle_block(offset, ScanBlockScalar(text.data() + offset, min(BLOCK_SIZE, text.size() - offset), has_control));
+    }
+    return has_control;
+}
+
+#ifdef STRING_PROCESSING_X86
+
+template <typename BlockHandler>
+__attribute__((target("sse2")))
+bool ScanBlocksSse2(string_view text, BlockHandler& handle_block) {
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i last_control = _mm_set1_epi8(' ' - 1);
+    __m128i controls = _mm_setzero_si128();
+    size_t offset = 0;
+    for (; offset + BLOCK_SIZE <= text.size(); offset += BLOCK_SIZE) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + offset));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + offset + 16));
+        // the unsigned minimum leaves only control characters unchanged
+        controls = _mm_or_si128(controls, _mm_cmpeq_epi8(_mm_min_epu8(low, last_control), low));
+        controls = _mm_or_si128(controls, _mm_cmpeq_epi8(_mm_min_epu8(high, last_control), high));
+        handle_block(offset, static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(low, spaces)))
+                                 | static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(high, spaces))) << 16);
+    }
+    bool has_control = _mm_movemask_epi8(controls) != 0;
+    if (offset < text.size()) {
+        handle_block(offset, ScanBlockScalar(text.data() + offset, text.size() - offset, has_control));
+    }
+    return has_control;
+}
+
+template <typename BlockHandler>
+__attribute__((target("avx2")))
+bool ScanBlocksAvx2(string_view text, BlockHandler& handle_block) {
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i last_control = _mm256_set1_epi8(' ' - 1);
+    __m256i controls = _mm256_setzero_si256();
+    size_t offset = 0;
+    for (; offset + BLOCK_SIZE <= text.size(); offset += BLOCK_SIZE) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + offset));
+        controls = _mm256_or_si256(controls, _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, last_control), bytes));
+        handle_block(offset, static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, spaces))));
+    }
+    bool has_control = !_mm256_testz_si256(controls, controls);
+    if (offset < text.size()) {
+        handle_block(offset, ScanBlockScalar(text.data() + offset, text.size() - offset, has_control));
+    }
+    return has_control;
+}
+
+#endif
+
+SimdLevel DetectSimdLevel() {
+#ifdef STRING_PROCESSING_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::SSE2;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+template <typename BlockHandler>
+bool ScanBlocks(SimdLevel level, string_view text, BlockHandler& handle_block) {
+    switch (level) {
+#ifdef STRING_PROCESSING_X86
+    case SimdLevel::AVX2:
+        return ScanBlocksAvx2(text, handle_block);
+    case SimdLevel::SSE2:
+        return ScanBlocksSse2(text, handle_block);
+#endif
+    default:
+        return ScanBlocksScalar(text, handle_block);
+    }
+}
+
+} // namespace
+
+SimdLevel GetSupportedSimdLevel() {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
 vector<string_view> SplitIntoWords(string_view text) {
-    int i = 0;
-    int len = 0;
     vector<string_view> words;
-    std::for_each(text.begin(), text.end(),
-        [&](const char& c) {
-            if (c == ' ') {
-                if (len) {
-                    words.push_back(text.substr(i, len));
-                    i += len;
-                    len = 0;
-                }
-                ++i;
-
-            } else {
-                ++len;
-            }
-        });
-    
-    if (len) {
-        words.push_back(text.substr(i, len));
-    } 
+    SplitIntoWords(text, words);
     return words;
-}
\ No newline at end of file
+}
+
+bool SplitIntoWords(string_view text, vector<string_view>& words) {
+    return SplitIntoWords(GetSupportedSimdLevel(), text, words);
+}
+
+bool SplitIntoWords(SimdLevel level, string_view text, vector<string_view>& words) {
+    if (level > GetSupportedSimdLevel()) {
+        throw invalid_argument("instruction set is not supported");
+    }
+    WordCollector collect_words(text, words);
+    const bool has_control = ScanBlocks(level, text, collect_words);
+    collect_words.Finish();
+    return !has_control;
+}
+
+bool ContainsControlCharacters(string_view text) {
+    auto ignore_spaces = [](size_t, uint32_t) {};
+    return ScanBlocks(GetSupportedSimdLevel(), text, ignore_spaces);
+}
@@ -1,19 +1,27 @@
 #pragma once
 
-#include <set>
 #include <string>
 #include <string_view>
 #include <vector>
 
+// Instruction sets the tokenizer can scan text with
+enum class SimdLevel {
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+// The widest level the CPU supports, which SplitIntoWords uses
+SimdLevel GetSupportedSimdLevel();
+
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
-template <typename StringContainer>
-std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string, std::less<>> non_empty_strings;
-    for (auto& str : strings) {
-        if (!str.empty()) {
-            non_empty_strings.insert(std::string(str));
-        }
-    }
-    return non_empty_strings;
-}
\ No newline at end of file
+// Replaces the contents of words with the space-separated words of text, keeping its capacity,
+// and returns whether none of them contains a control character. Spaces and control
+// characters are found in the same pass over 16 or 32 bytes at a time.
+bool SplitIntoWords(std::string_view text, std::vector<std::string_view>& words);
+// The same with the given level, which must be supported
+bool SplitIntoWords(SimdLevel level, std::string_view text, std::vector<std::string_view>& words);
+
+// Whether text contains a character below the space
+bool ContainsControlCharacters(std::string_view text);
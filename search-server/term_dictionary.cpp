@@ -0,0 +1,102 @@
+#include "term_dictionary.h"
+
+using namespace std;
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+    : terms_(other.terms_)
+    , is_external_(other.is_external_)
+    , free_ids_(other.free_ids_) {
+    for (TermId id = 0; id < terms_.size(); ++id) {
+        if (!is_external_[id]) {
+            terms_[id] = arena_.Store(terms_[id]);
+        }
+    }
+    RebuildIds();
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        TermDictionary copy(other);
+        *this = move(copy);
+    }
+    return *this;
+}
+
+TermId TermDictionary::Intern(string_view term) {
+    if (const auto it = ids_.find(term); it != ids_.end()) {
+        return it->second;
+    }
+    if (!free_ids_.empty()) {
+        const TermId id = free_ids_.back();
+        free_ids_.pop_back();
+        terms_[id] = arena_.Store(term);
+        is_external_[id] = false;
+        ids_.emplace(terms_[id], id);
+        return id;
+    }
+    const auto id = static_cast<TermId>(terms_.size());
+    terms_.push_back(arena_.Store(term));
+    is_external_.push_back(false);
+    ids_.emplace(terms_.back(), id);
+    return id;
+}
+
+TermId TermDictionary::InternExternal(string_view term) {
+    const auto id = static_cast<TermId>(terms_.size());
+    terms_.push_back(term);
+    is_external_.push_back(true);
+    if (term.empty()) {
+        free_ids_.push_back(id);
+    } else {
+        ids_.emplace(term, id);
+    }
+    return id;
+}
+
+void TermDictionary::Reserve(size_t term_count) {
+    terms_.reserve(term_count);
+    is_external_.reserve(term_count);
+    ids_.reserve(term_count);
+}
+
+TermId TermDictionary::Find(string_view term) const {
+    const auto it = ids_.find(term);
+    return it == ids_.end() ? NO_TERM : it->second;
+}
+
+string_view TermDictionary::GetTerm(TermId id) const {
+    return terms_.at(id);
+}
+
+size_t TermDictionary::GetTermCount() const {
+    return terms_.size();
+}
+
+void TermDictionary::Retire(TermId id) {
+    const string_view term = terms_.at(id);
+    if (term.empty()) {
+        return;
+    }
+    ids_.erase(term);
+    if (!is_external_[id]) {
+        arena_.Release(term);
+    }
+    terms_[id] = {};
+    free_ids_.push_back(id);
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+    // a hash table node holds the key, the value and the next pointer
+    const size_t node_size = sizeof(pair<const string_view, TermId>) + sizeof(void*);
+    return arena_.GetMemoryUsage() + terms_.capacity() * sizeof(string_view) + is_external_.capacity() / 8
+        + free_ids_.capacity() * sizeof(TermId) + ids_.size() * node_size + ids_.bucket_count() * sizeof(void*);
+}
+
+void TermDictionary::RebuildIds() {
+    ids_.clear();
+    for (TermId id = 0; id < terms_.size(); ++id) {
+        if (!terms_[id].empty()) {
+            ids_.emplace(terms_[id], id);
+        }
+    }
+}
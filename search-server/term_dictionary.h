@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "string_arena.h"
+
+using TermId = uint32_t;
+
+// Interns every indexed word once and hands out dense ids.
+// Interned words are packed into an arena; views returned by GetTerm stay valid
+// until the term is retired. Ids of retired terms are handed out again.
+class TermDictionary {
+public:
+    static constexpr TermId NO_TERM = UINT32_MAX;
+
+    TermDictionary() = default;
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& other);
+    TermDictionary(TermDictionary&&) = default;
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    // A new term takes the id retired last, if any
+    TermId Intern(std::string_view term);
+
+    // Appends the term under the next id without copying it; the viewed memory must
+    // outlive the dictionary. An empty term restores a retired id.
+    TermId InternExternal(std::string_view term);
+
+    void Reserve(size_t term_count);
+
+    TermId Find(std::string_view term) const;
+
+    // Empty for retired terms
+    std::string_view GetTerm(TermId id) const;
+
+    size_t GetTermCount() const;
+
+    // Forgets a term no document uses any more, invalidating the views of it. The arena
+    // frees the chunks left without live terms, and a later Intern reuses the id, so
+    // everything the caller keeps by TermId must be reset for it.
+    void Retire(TermId id);
+
+    // Heap bytes of the interned words and the lookup structures, estimated for the hash table
+    size_t GetMemoryUsage() const;
+
+private:
+    // views into arena_ or, for is_external_ terms, into memory passed to InternExternal
+    std::vector<std::string_view> terms_;
+    std::vector<bool> is_external_;
+    std::unordered_map<std::string_view, TermId> ids_;
+    // retired ids, the last one reused first
+    std::vector<TermId> free_ids_;
+    StringArena arena_;
+
+    void RebuildIds();
+};
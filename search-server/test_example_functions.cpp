@@ -1,7 +1,133 @@
 #include "test_example_functions.h"
 
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <map>
+#include <random>
+#include <set>
+#include <thread>
+#include <tuple>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "process_queries.h"
+#include "query_service.h"
+#include "remove_duplicates.h"
+#include "search_coordinator.h"
+#include "search_worker.h"
+#include "sharded_search_server.h"
+#include "stop_word_set.h"
+#include "string_processing.h"
+#include "versioned_search_server.h"
+
 using namespace std;
 
+namespace {
+
+// a predicate instead of a status keeps benchmarks away from the query result cache
+bool IsActual(int document_id, DocumentStatus status, int rating) {
+    return status == DocumentStatus::ACTUAL;
+}
+
+#define ASSERT_HINT(expr, hint) AssertImpl(static_cast<bool>(expr), #expr, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+#define RUN_TEST(func) RunTestImpl((func), #func)
+
+void AssertImpl(bool value, const string& expr_str, const string& file, const string& func, unsigned line,
+                const string& hint) {
+    if (!value) {
+        cerr << file << "("s << line << "): "s << func << ": ASSERT("s << expr_str << ") failed. Hint: "s << hint << endl;
+        abort();
+    }
+}
+
+template <typename TestFunc>
+void RunTestImpl(TestFunc func, const string& func_str) {
+    func();
+    cerr << func_str << " OK"s << endl;
+}
+
+// Texts of words "w0" ... "w{vocabulary_size - 1}", the lower ones more frequent as in real text
+vector<string> GenerateTexts(size_t text_count, size_t vocabulary_size, uint32_t seed) {
+    mt19937 generator(seed);
+    uniform_int_distribution<size_t> word(0, vocabulary_size - 1);
+    vector<string> texts(text_count);
+    for (string& text : texts) {
+        const int word_count = uniform_int_distribution<int>(1, 20)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += "w"s + to_string(min(word(generator), word(generator))) + " "s;
+        }
+    }
+    return texts;
+}
+
+// Queries of plus words, minus words and the stop word "and" over the words of GenerateTexts
+vector<string> GenerateQueries(size_t query_count, size_t vocabulary_size, uint32_t seed) {
+    mt19937 generator(seed);
+    uniform_int_distribution<size_t> word(0, vocabulary_size - 1);
+    vector<string> queries(query_count);
+    for (string& query : queries) {
+        const int word_count = uniform_int_distribution<int>(1, 6)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            const int kind = uniform_int_distribution<int>(0, 9)(generator);
+            query += kind == 0 ? "-"s : kind == 1 ? "and "s : ""s;
+            query += "w"s + to_string(word(generator)) + " "s;
+        }
+    }
+    return queries;
+}
+
+// Relevances and ratings must match in order; ids only where no other document of either
+// result has the same relevance and rating, since the order and the cut of full ties are
+// unspecified
+void AssertSameDocuments(const vector<Document>& lhs, const vector<Document>& rhs, const string& hint) {
+    ASSERT_HINT(lhs.size() == rhs.size(), hint);
+    const auto is_tied = [](const Document& lhs, const Document& rhs) {
+        return lhs.id != rhs.id && abs(lhs.relevance - rhs.relevance) < CORRECTION && lhs.rating == rhs.rating;
+    };
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        ASSERT_HINT(abs(lhs[i].relevance - rhs[i].relevance) < CORRECTION, hint);
+        ASSERT_HINT(lhs[i].rating == rhs[i].rating, hint);
+        const auto ties = [&](const Document& other) { return is_tied(other, lhs[i]); };
+        const bool has_tie = any_of(lhs.begin(), lhs.end(), ties) || any_of(rhs.begin(), rhs.end(), ties);
+        ASSERT_HINT(has_tie || lhs[i].id == rhs[i].id, hint);
+    }
+}
+
+void AssertSameResults(const SearchServer& expected, const SearchServer& actual, const vector<string>& queries) {
+    ASSERT_HINT(expected.GetDocumentCount() == actual.GetDocumentCount(), "document count"s);
+    for (const string& query : queries) {
+        AssertSameDocuments(expected.FindTopDocuments(query), actual.FindTopDocuments(query), query);
+    }
+}
+
+string ReadFile(const string& path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+void WriteFile(const string& path, const string& content) {
+    ofstream(path, ios::binary | ios::trunc).write(content.data(), content.size());
+}
+
+bool IsSnapshotRejected(const string& path) {
+    try {
+        SearchServer::LoadSnapshot(path);
+    } catch (const runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
 void MatchDocuments(SearchServer& search_server, string& text) {
     LOG_DURATION("Matching documents on request:");
     search_server.MatchDocument(text, 0);
@@ -15,4 +141,1216 @@ void FindTopDocuments(SearchServer& search_server, string& text) {
 void AddDocument(SearchServer& search_server, string text, vector<int> ratings, int id, DocumentStatus status) {
     LOG_DURATION("Addings documents to server:");
     search_server.AddDocument(id, text, status, ratings);
-}
\ No newline at end of file
+}
+
+void BenchmarkQueryPartitions(SearchServer& search_server, const vector<string>& queries, size_t max_partition_count) {
+    for (size_t partition_count = 1; partition_count <= max_partition_count; partition_count *= 2) {
+        search_server.SetQueryPartitionCount(partition_count);
+        LOG_DURATION("Parallel search of "s + to_string(queries.size()) + " queries on "s
+                     + to_string(partition_count) + " partitions:"s);
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(execution::par, query, IsActual);
+        }
+    }
+}
+
+void BenchmarkQueryEvaluation(SearchServer& search_server, const vector<string>& queries) {
+    for (const QueryEvaluation evaluation : {QueryEvaluation::EXHAUSTIVE, QueryEvaluation::PRUNED}) {
+        LOG_DURATION((evaluation == QueryEvaluation::PRUNED ? "Pruned"s : "Exhaustive"s) + " search of "s
+                     + to_string(queries.size()) + " queries:"s);
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(evaluation, query, IsActual);
+        }
+    }
+}
+
+void BenchmarkPostingLists(size_t document_count, size_t posting_count) {
+    mt19937 generator(42);
+    vector<DocumentOrdinal> ordinals(posting_count);
+    for (DocumentOrdinal& ordinal : ordinals) {
+        ordinal = uniform_int_distribution<DocumentOrdinal>(0, document_count - 1)(generator);
+    }
+    sort(ordinals.begin(), ordinals.end());
+    ordinals.erase(unique(ordinals.begin(), ordinals.end()), ordinals.end());
+
+    PostingList postings;
+    vector<double> term_freqs;
+    term_freqs.reserve(ordinals.size());
+    for (const DocumentOrdinal ordinal : ordinals) {
+        const uint32_t document_length = uniform_int_distribution<uint32_t>(1, 300)(generator);
+        const uint32_t term_count = uniform_int_distribution<uint32_t>(1, 3)(generator);
+        postings.Add(ordinal, term_count, document_length);
+        term_freqs.push_back(static_cast<double>(term_count) / document_length);
+    }
+    postings.Seal();
+
+    const size_t plain_bytes = ordinals.size() * (sizeof(DocumentOrdinal) + sizeof(double));
+    cerr << ordinals.size() << " postings: "s << static_cast<double>(postings.GetMemoryUsage()) / ordinals.size()
+         << " bytes per posting compressed, "s << static_cast<double>(plain_bytes) / ordinals.size()
+         << " bytes per posting plain"s << endl;
+
+    const int pass_count = 20;
+    double checksum = 0.0;
+    {
+        LOG_DURATION("Decoding compressed postings "s + to_string(pass_count) + " times:"s);
+        for (int pass = 0; pass < pass_count; ++pass) {
+            postings.ForEach([&](DocumentOrdinal ordinal, double term_freq) {
+                checksum += ordinal * term_freq;
+            });
+        }
+    }
+    {
+        LOG_DURATION("Reading plain postings "s + to_string(pass_count) + " times:"s);
+        for (int pass = 0; pass < pass_count; ++pass) {
+            for (size_t i = 0; i < ordinals.size(); ++i) {
+                checksum -= ordinals[i] * term_freqs[i];
+            }
+        }
+    }
+    // keeps both loops from being optimized away
+    cerr << "Checksum difference: "s << checksum << endl;
+}
+
+void BenchmarkTokenizer(size_t text_size) {
+    mt19937 generator(42);
+    string text;
+    text.reserve(text_size + 16);
+    while (text.size() < text_size) {
+        const size_t word_length = uniform_int_distribution<size_t>(1, 12)(generator);
+        for (size_t i = 0; i < word_length; ++i) {
+            text.push_back(static_cast<char>(uniform_int_distribution<int>('a', 'z')(generator)));
+        }
+        text.push_back(' ');
+    }
+
+    // about 2 GB per instruction set
+    const size_t pass_count = max<size_t>(1, (size_t{2} << 30) / text.size());
+    vector<string_view> words;
+    for (const SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        if (level > GetSupportedSimdLevel()) {
+            continue;
+        }
+        size_t word_count = 0;
+        const auto start = chrono::steady_clock::now();
+        for (size_t pass = 0; pass < pass_count; ++pass) {
+            SplitIntoWords(level, text, words);
+            word_count += words.size();
+        }
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        static const char* const level_names[] = {"Scalar", "SSE2", "AVX2"};
+        cerr << level_names[static_cast<int>(level)] << " tokenizer: "s
+             << static_cast<double>(text.size() * pass_count) / elapsed.count() / 1e9 << " GB/s, "s
+             << word_count / pass_count << " words"s << endl;
+    }
+}
+
+void BenchmarkStopWords(size_t stop_word_count, size_t lookup_count) {
+    mt19937 generator(42);
+    const auto random_word = [&generator] {
+        string word(uniform_int_distribution<size_t>(1, 10)(generator), ' ');
+        for (char& c : word) {
+            c = static_cast<char>(uniform_int_distribution<int>('a', 'z')(generator));
+        }
+        return word;
+    };
+    vector<string> stop_words(stop_word_count);
+    generate(stop_words.begin(), stop_words.end(), random_word);
+    // about one word in four is a stop word, as in ordinary text
+    vector<string> words(lookup_count);
+    for (string& word : words) {
+        word = uniform_int_distribution<int>(0, 3)(generator) == 0
+            ? stop_words[uniform_int_distribution<size_t>(0, stop_word_count - 1)(generator)]
+            : random_word();
+    }
+
+    const set<string, less<>> tree(stop_words.begin(), stop_words.end());
+    const StopWordSet table(stop_words);
+    size_t tree_hits = 0;
+    size_t table_hits = 0;
+    {
+        LOG_DURATION("std::set stop words");
+        for (const string& word : words) {
+            tree_hits += tree.count(string_view(word));
+        }
+    }
+    {
+        LOG_DURATION("StopWordSet stop words");
+        for (const string& word : words) {
+            table_hits += table.Contains(word);
+        }
+    }
+    cerr << "Stop words found: "s << tree_hits << " and "s << table_hits << endl;
+}
+
+void BenchmarkQueryStream(const SearchServer& search_server, const vector<string>& queries, size_t max_in_flight) {
+    size_t materialized_count = 0;
+    {
+        LOG_DURATION("ProcessQueries");
+        for (const vector<Document>& documents : ProcessQueries(search_server, queries)) {
+            materialized_count += documents.size();
+        }
+    }
+    QueryStreamOptions options;
+    options.max_in_flight = max_in_flight;
+    for (const bool ordered : {true, false}) {
+        options.ordered = ordered;
+        size_t streamed_count = 0;
+        LOG_DURATION(ordered ? "Ordered ProcessQueryStream" : "Unordered ProcessQueryStream");
+        ProcessQueryStream(search_server, queries.begin(), queries.end(), [&streamed_count](QueryStreamResult&& result) {
+            streamed_count += result.documents.size();
+        }, options);
+        cerr << "Documents found: "s << materialized_count << " and "s << streamed_count << endl;
+    }
+}
+
+void BenchmarkQueryBatches(const SearchServer& search_server, const vector<string>& queries, size_t batch_size) {
+    size_t one_at_a_time_count = 0;
+    {
+        LOG_DURATION("Queries one at a time");
+        for (const vector<Document>& documents : ProcessQueries(search_server, queries)) {
+            one_at_a_time_count += documents.size();
+        }
+    }
+    size_t batched_count = 0;
+    {
+        LOG_DURATION("Queries in batches");
+        for (const vector<Document>& documents : ProcessQueriesBatched(search_server, queries, batch_size)) {
+            batched_count += documents.size();
+        }
+    }
+    cerr << "Documents found: "s << one_at_a_time_count << " and "s << batched_count << endl;
+}
+
+void BenchmarkQueryService(const SearchServer& search_server, const vector<string>& queries,
+                           size_t thread_count, size_t max_queue_depth) {
+    QueryServiceOptions options;
+    options.thread_count = thread_count;
+    options.max_queue_depth = max_queue_depth;
+    QueryService service(search_server, options);
+    size_t document_count = 0;
+    size_t rejected_count = 0;
+    {
+        LOG_DURATION("QueryService");
+        vector<future<vector<Document>>> results;
+        results.reserve(queries.size());
+        for (const string& query : queries) {
+            results.push_back(service.FindTopDocumentsAsync(query));
+        }
+        for (future<vector<Document>>& result : results) {
+            try {
+                document_count += result.get().size();
+            } catch (const QueryRejected&) {
+                ++rejected_count;
+            }
+        }
+    }
+    cerr << "Documents found: "s << document_count << ", rejected queries: "s << rejected_count << endl;
+}
+
+void TestSnapshots() {
+    const vector<string> texts = GenerateTexts(3000, 500, 1);
+    const vector<string> queries = GenerateQueries(200, 600, 2);
+    SearchServer search_server("and with"s);
+    for (size_t id = 0; id < texts.size(); ++id) {
+        search_server.AddDocument(static_cast<int>(id), texts[id],
+                                  id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {static_cast<int>(id % 11)});
+    }
+    for (int id = 0; id < static_cast<int>(texts.size()); id += 3) {
+        search_server.RemoveDocument(id);
+    }
+    const string path = "/tmp/search-server-test-"s + to_string(getpid()) + ".snapshot"s;
+    search_server.SaveSnapshot(path);
+
+    {
+        SearchServer loaded = SearchServer::LoadSnapshot(path);
+        AssertSameResults(search_server, loaded, queries);
+        for (const string& query : queries) {
+            AssertSameDocuments(search_server.FindTopDocuments(query, DocumentStatus::BANNED),
+                                loaded.FindTopDocuments(query, DocumentStatus::BANNED), query);
+        }
+        for (const int id : {1, 2, 1000, 2999}) {
+            ASSERT_HINT(search_server.MatchDocument("w1 w2 w3 w4 -w400"s, id) == loaded.MatchDocument("w1 w2 w3 w4 -w400"s, id),
+                        "MatchDocument of "s + to_string(id));
+            ASSERT_HINT(search_server.GetWordFrequencies(id) == loaded.GetWordFrequencies(id),
+                        "GetWordFrequencies of "s + to_string(id));
+        }
+
+        // updates copy the mapped data they change, and saving replaces the mapped file under the loaded server
+        for (SearchServer* server : {&search_server, &loaded}) {
+            server->AddDocument(5000, "w1 w2 brand new words"s, DocumentStatus::ACTUAL, {5});
+            server->RemoveDocuments({1, 2, 4, 5});
+            server->RemoveDocument(1000);
+        }
+        loaded.SaveSnapshot(path);
+        AssertSameResults(search_server, loaded, queries);
+        AssertSameDocuments(search_server.FindTopDocuments("brand new"s), loaded.FindTopDocuments("brand new"s), "new words"s);
+        AssertSameResults(search_server, SearchServer::LoadSnapshot(path), queries);
+    }
+
+    const string snapshot = ReadFile(path);
+    for (const size_t size : {size_t{0}, sizeof(SnapshotHeader) - 1, sizeof(SnapshotHeader), snapshot.size() / 2,
+                              snapshot.size() - 8}) {
+        WriteFile(path, snapshot.substr(0, size));
+        ASSERT_HINT(IsSnapshotRejected(path), "snapshot truncated to "s + to_string(size) + " bytes"s);
+    }
+    string other_version = snapshot;
+    const uint64_t version = SNAPSHOT_VERSION + 1;
+    memcpy(other_version.data() + offsetof(SnapshotHeader, version), &version, sizeof(version));
+    WriteFile(path, other_version);
+    ASSERT_HINT(IsSnapshotRejected(path), "snapshot of another version"s);
+
+    // every corrupted byte of a small snapshot is either rejected at load or stays within the
+    // file; the damaged index may rank wrongly but must serve and update without crashing
+    SearchServer small_server("and with"s);
+    const vector<string> small_texts = GenerateTexts(60, 40, 17);
+    for (size_t id = 0; id < small_texts.size(); ++id) {
+        small_server.AddDocument(static_cast<int>(id * 2), small_texts[id],
+                                 id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {static_cast<int>(id % 7)});
+    }
+    small_server.RemoveDocument(10);
+    small_server.SaveSnapshot(path);
+    const string small_snapshot = ReadFile(path);
+    const vector<string> small_queries = GenerateQueries(10, 50, 18);
+    size_t rejected_count = 0;
+    for (size_t position = 0; position < small_snapshot.size(); ++position) {
+        for (const char mask : {'\x01', '\x80', '\xff'}) {
+            string corrupted = small_snapshot;
+            corrupted[position] ^= mask;
+            WriteFile(path, corrupted);
+            if (IsSnapshotRejected(path)) {
+                ++rejected_count;
+                continue;
+            }
+            SearchServer loaded = SearchServer::LoadSnapshot(path);
+            for (const string& query : small_queries) {
+                loaded.FindTopDocuments(query);
+                loaded.FindTopDocuments(QueryEvaluation::PRUNED, query, DocumentStatus::BANNED);
+            }
+            for (const int id : loaded) {
+                loaded.MatchDocument(small_queries[0], id);
+            }
+            loaded.RemoveDocuments({0, 2, 4});
+            loaded.RemoveDocument(6);
+            loaded.AddDocument(1000, "w1 w2 w3"s, DocumentStatus::ACTUAL, {1});
+            loaded.FindTopDocuments(small_queries[1]);
+        }
+    }
+    ASSERT_HINT(rejected_count > 0, "corrupted snapshots rejected"s);
+    unlink(path.c_str());
+}
+
+void TestTermRetirement() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(0, "kept words stay valid"s, DocumentStatus::ACTUAL, {1});
+    const auto [matched_words, status] = search_server.MatchDocument("kept stay valid"s, 0);
+    const set<string_view> words = search_server.GetWordsById(0);
+    // churn through enough words to free many arena chunks
+    const int batch_size = 1000;
+    for (int batch = 0; batch < 20; ++batch) {
+        vector<string> texts(batch_size);
+        vector<NewDocument> documents;
+        vector<int> ids;
+        for (int i = 0; i < batch_size; ++i) {
+            const int id = 1 + batch * batch_size + i;
+            texts[i] = "kept churned"s + to_string(id) + string(40, 'x') + " other"s + to_string(id);
+            documents.push_back({id, texts[i], DocumentStatus::ACTUAL, {1}});
+            ids.push_back(id);
+        }
+        search_server.AddDocuments(documents);
+        if (batch % 2 == 0) {
+            search_server.RemoveDocuments(ids);
+        } else {
+            for (const int id : ids) {
+                search_server.RemoveDocument(id);
+            }
+        }
+    }
+    ASSERT_HINT((matched_words == vector<string_view>{"kept"sv, "stay"sv, "valid"sv}), "matched words"s);
+    ASSERT_HINT((words == set<string_view>{"kept"sv, "stay"sv, "valid"sv, "words"sv}), "words of the document"s);
+    ASSERT_HINT(search_server.GetDocumentFreq("kept"sv) == 1, "document frequency"s);
+    ASSERT_HINT(search_server.GetDocumentFreq("other1"sv) == 0, "retired word"s);
+    ASSERT_HINT(search_server.FindTopDocuments("valid"s).size() == 1, "search after churn"s);
+
+    TermDictionary terms;
+    for (int i = 0; i < 1000; ++i) {
+        const TermId term = terms.Intern("term"s + to_string(i));
+        ASSERT_HINT(terms.GetTerm(term) == "term"s + to_string(i), "interned term"s);
+        terms.Retire(term);
+    }
+    ASSERT_HINT(terms.GetTermCount() == 1, "retired ids are reused"s);
+    ASSERT_HINT(terms.Find("term999"sv) == TermDictionary::NO_TERM, "retired term is forgotten"s);
+}
+
+void TestPostingLists() {
+    mt19937 generator(3);
+    PostingList postings;
+    map<DocumentOrdinal, pair<uint32_t, uint32_t>> expected;
+    for (int step = 0; step < 20000; ++step) {
+        const int action = uniform_int_distribution<int>(0, 99)(generator);
+        // mostly ascending appends, as documents are added
+        const DocumentOrdinal ordinal = action < 70 ? static_cast<DocumentOrdinal>(step)
+                                                    : uniform_int_distribution<DocumentOrdinal>(0, step)(generator);
+        if (action < 85) {
+            const uint32_t term_count = uniform_int_distribution<uint32_t>(1, 3)(generator);
+            const uint32_t document_length = expected.count(ordinal) ? expected[ordinal].second
+                                                                     : uniform_int_distribution<uint32_t>(3, 50)(generator);
+            postings.Add(ordinal, term_count, document_length);
+            expected[ordinal].first += term_count;
+            expected[ordinal].second = document_length;
+        } else if (action < 97) {
+            ASSERT_HINT(postings.Remove(ordinal) == (expected.erase(ordinal) > 0), "removal of "s + to_string(ordinal));
+        } else {
+            postings.Seal();
+            ASSERT_HINT(postings.IsSealed(), "sealed"s);
+        }
+    }
+    vector<DocumentOrdinal> removed;
+    for (DocumentOrdinal ordinal = 0; ordinal < 20000; ordinal += 5) {
+        removed.push_back(ordinal);
+        expected.erase(ordinal);
+    }
+    postings.Remove(removed);
+
+    ASSERT_HINT(postings.GetDocumentFreq() == expected.size(), "document frequency"s);
+    auto it = expected.begin();
+    postings.ForEachPosting([&](const PostingList::Posting& posting) {
+        ASSERT_HINT(it != expected.end() && it->first == posting.ordinal, "ordinal "s + to_string(posting.ordinal));
+        ASSERT_HINT(it->second == pair(posting.term_count, posting.document_length), "counts"s);
+        ++it;
+    });
+    ASSERT_HINT(it == expected.end(), "missing postings"s);
+    for (DocumentOrdinal ordinal = 0; ordinal < 20000; ordinal += 7) {
+        ASSERT_HINT(postings.Contains(ordinal) == (expected.count(ordinal) > 0), "Contains "s + to_string(ordinal));
+    }
+    postings.Seal();
+    postings.ShrinkToFit();
+    ASSERT_HINT(postings.GetMemoryUsage() < expected.size() * sizeof(PostingList::Posting) / 2, "compressed size"s);
+
+    // a bulk batch seals its lists, and a dense index writes them to snapshots as they are
+    const vector<string> texts = GenerateTexts(POSTING_SEAL_MIN_BATCH_SIZE * 2, 300, 4);
+    vector<NewDocument> documents;
+    for (size_t id = 0; id < texts.size(); ++id) {
+        documents.push_back({static_cast<int>(id), texts[id], DocumentStatus::ACTUAL, {static_cast<int>(id % 5)}});
+    }
+    SearchServer search_server("and with"s);
+    search_server.AddDocuments(documents);
+    const string path = "/tmp/search-server-test-"s + to_string(getpid()) + ".snapshot"s;
+    search_server.SaveSnapshot(path);
+    AssertSameResults(search_server, SearchServer::LoadSnapshot(path), GenerateQueries(100, 300, 5));
+    unlink(path.c_str());
+}
+
+void TestPrunedEvaluation() {
+    // every text is indexed several times with different ratings, so many relevances tie
+    const vector<string> texts = GenerateTexts(1500, 400, 6);
+    const vector<string> queries = GenerateQueries(300, 450, 7);
+    SearchServer search_server("and with"s);
+    search_server.SetQueryCacheCapacity(0);
+    for (size_t id = 0; id < texts.size() * 3; ++id) {
+        search_server.AddDocument(static_cast<int>(id), texts[id % texts.size()],
+                                  id % 5 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL,
+                                  {static_cast<int>(id % 4), static_cast<int>(id % 3)});
+    }
+    for (int id = 0; id < static_cast<int>(texts.size()); id += 4) {
+        search_server.RemoveDocument(id);
+    }
+    const auto is_odd = [](int document_id, DocumentStatus status, int rating) {
+        return document_id % 2 == 1;
+    };
+    for (const size_t count : {size_t{1}, size_t{5}, size_t{40}}) {
+        search_server.SetMaxResultDocumentCount(count);
+        for (const string& query : queries) {
+            const string hint = query + " top "s + to_string(count);
+            AssertSameDocuments(search_server.FindTopDocuments(QueryEvaluation::EXHAUSTIVE, query),
+                                search_server.FindTopDocuments(QueryEvaluation::PRUNED, query), hint);
+            AssertSameDocuments(search_server.FindTopDocuments(QueryEvaluation::EXHAUSTIVE, query, DocumentStatus::IRRELEVANT),
+                                search_server.FindTopDocuments(QueryEvaluation::PRUNED, query, DocumentStatus::IRRELEVANT), hint);
+            AssertSameDocuments(search_server.FindTopDocuments(QueryEvaluation::EXHAUSTIVE, query, is_odd),
+                                search_server.FindTopDocuments(QueryEvaluation::PRUNED, query, is_odd), hint);
+        }
+    }
+
+    // equal relevance everywhere: only the ratings decide which documents make the top
+    SearchServer tied_server("and with"s);
+    for (int id = 0; id < 300; ++id) {
+        tied_server.AddDocument(id, id % 2 ? "red fox"s : "red dog"s, DocumentStatus::ACTUAL, {(id * 37) % 101});
+    }
+    const vector<Document> exhaustive = tied_server.FindTopDocuments(QueryEvaluation::EXHAUSTIVE, "fox"s, is_odd);
+    AssertSameDocuments(exhaustive, tied_server.FindTopDocuments(QueryEvaluation::PRUNED, "fox"s, is_odd), "ties"s);
+    ASSERT_HINT(exhaustive.size() == MAX_RESULT_DOCUMENT_COUNT && exhaustive.front().rating == 100, "highest ratings first"s);
+}
+
+void TestMinusWordBitmaps() {
+    // "common" is in half of the documents, so it is excluded through a bitmap
+    const vector<string> texts = GenerateTexts(8000, 200, 19);
+    const vector<string> queries = GenerateQueries(100, 200, 20);
+    SearchServer search_server("and with"s);
+    // cached results would hide a stale bitmap
+    search_server.SetQueryCacheCapacity(0);
+    set<int> with_common;
+    const auto add = [&](int id, bool is_common) {
+        search_server.AddDocument(id, texts[id] + (is_common ? "common"s : ""s), DocumentStatus::ACTUAL, {id % 7});
+        if (is_common) {
+            with_common.insert(id);
+        } else {
+            with_common.erase(id);
+        }
+    };
+    const auto assert_excluded = [&](const string& hint) {
+        const auto without_common = [&with_common](int document_id, DocumentStatus status, int rating) {
+            return with_common.count(document_id) == 0;
+        };
+        for (const string& query : queries) {
+            const vector<Document> expected = search_server.FindTopDocuments(query, without_common);
+            const vector<Document> documents = search_server.FindTopDocuments(query + "-common"s);
+            AssertSameDocuments(expected, documents, hint + ": "s + query);
+            AssertSameDocuments(expected, search_server.FindTopDocuments(execution::par, query + "-common"s), hint + ": "s + query);
+            for (const Document& document : documents) {
+                ASSERT_HINT(with_common.count(document.id) == 0, hint + ": "s + query);
+            }
+        }
+    };
+
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        add(id, id % 2 == 0);
+    }
+    assert_excluded("initial"s);
+    // the same ids come back with the word on the other documents
+    for (int id = 0; id < 200; ++id) {
+        search_server.RemoveDocument(id);
+        add(id, id % 2 == 1);
+    }
+    assert_excluded("re-added"s);
+    // enough removals to renumber the ordinals the bitmaps are built on
+    vector<int> removed;
+    for (int id = 1000; id < 4000; ++id) {
+        removed.push_back(id);
+        with_common.erase(id);
+    }
+    search_server.RemoveDocuments(removed);
+    assert_excluded("compacted"s);
+    for (const int id : removed) {
+        add(id, id % 3 == 0);
+    }
+    assert_excluded("re-added after compaction"s);
+}
+
+void TestQueryResultCache() {
+    const vector<string> texts = GenerateTexts(3000, 300, 21);
+    // distinct minus words keep every query a distinct cache key
+    vector<string> queries;
+    for (int k = 0; k < 100; ++k) {
+        queries.push_back("w"s + to_string(k) + " and w"s + to_string(k * 7 % 300) + " -w"s + to_string(k + 150));
+    }
+    SearchServer search_server("and with"s);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        search_server.AddDocument(id, texts[id], id % 5 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL, {id % 7});
+    }
+    ASSERT_HINT(search_server.GetQueryCacheStats().hits == 0 && search_server.GetQueryCacheStats().misses == 0, "no queries"s);
+    const auto is_irrelevant = [](int document_id, DocumentStatus status, int rating) {
+        return status == DocumentStatus::IRRELEVANT;
+    };
+    // predicate queries are never cached, so they give the results of the current index
+    const auto assert_fresh = [&](const string& hint) {
+        const QueryCacheStats before = search_server.GetQueryCacheStats();
+        vector<vector<Document>> results;
+        for (const string& query : queries) {
+            results.push_back(search_server.FindTopDocuments(query));
+            AssertSameDocuments(search_server.FindTopDocuments(query, IsActual), results.back(), hint + ": "s + query);
+        }
+        const QueryCacheStats missed = search_server.GetQueryCacheStats();
+        ASSERT_HINT(missed.misses == before.misses + queries.size() && missed.hits == before.hits, hint);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            AssertSameDocuments(results[i], search_server.FindTopDocuments(queries[i]), hint + ": "s + queries[i]);
+        }
+        const QueryCacheStats hit = search_server.GetQueryCacheStats();
+        ASSERT_HINT(hit.hits == missed.hits + queries.size() && hit.misses == missed.misses, hint);
+        // the status is part of the key
+        AssertSameDocuments(search_server.FindTopDocuments(queries[0], is_irrelevant),
+                            search_server.FindTopDocuments(queries[0], DocumentStatus::IRRELEVANT), hint);
+    };
+
+    assert_fresh("initial"s);
+    search_server.AddDocument(5000, "w1 w7 w1"s, DocumentStatus::ACTUAL, {100});
+    assert_fresh("added"s);
+    search_server.RemoveDocument(search_server.FindTopDocuments(queries[2]).front().id);
+    assert_fresh("removed"s);
+    search_server.RemoveDocuments({1, 2, 3, 4000});
+    assert_fresh("removed a batch"s);
+    // enough removals to renumber the ordinals
+    vector<int> removed;
+    for (int id = 1000; id < 2500; ++id) {
+        removed.push_back(id);
+    }
+    search_server.RemoveDocuments(removed);
+    assert_fresh("compacted"s);
+
+    search_server.SetQueryCacheCapacity(0);
+    const QueryCacheStats before = search_server.GetQueryCacheStats();
+    search_server.FindTopDocuments(queries[0]);
+    search_server.FindTopDocuments(queries[0]);
+    ASSERT_HINT(search_server.GetQueryCacheStats().hits == before.hits, "disabled cache"s);
+    search_server.SetQueryCacheCapacity(QueryResultCache::DEFAULT_CAPACITY);
+    assert_fresh("enabled again"s);
+}
+
+void TestVersionedSearchServer() {
+    const vector<string> texts = GenerateTexts(WRITE_SEGMENT_DOCUMENT_COUNT * 5, 800, 8);
+    const vector<string> queries = GenerateQueries(200, 900, 9);
+    SearchServer expected("and with"s);
+    SearchServer initial("and with"s);
+    const int initial_count = 1000;
+    for (int id = 0; id < initial_count; ++id) {
+        expected.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id % 9});
+        initial.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id % 9});
+    }
+    VersionedSearchServer versioned(move(initial));
+    const auto assert_same_results = [&](const string& hint) {
+        const VersionedSearchServer::Version version = versioned.GetVersion();
+        ASSERT_HINT(version->GetDocumentCount() == expected.GetDocumentCount(), hint);
+        for (const string& query : queries) {
+            AssertSameDocuments(expected.FindTopDocuments(query), version->FindTopDocuments(query), hint + ": "s + query);
+        }
+        for (const int id : expected) {
+            if (id % 97 == 0) {
+                ASSERT_HINT(expected.MatchDocument(queries[id % queries.size()], id)
+                            == version->MatchDocument(queries[id % queries.size()], id), hint);
+            }
+        }
+    };
+
+    mt19937 generator(10);
+    const int batch_size = 1000;
+    for (int first = initial_count; first < static_cast<int>(texts.size()); first += batch_size) {
+        vector<NewDocument> documents;
+        for (int id = first; id < min(first + batch_size, static_cast<int>(texts.size())); ++id) {
+            documents.push_back({id, texts[id], DocumentStatus::ACTUAL, {id % 9}});
+        }
+        expected.AddDocuments(documents);
+        versioned.AddDocuments(documents);
+        // removals hit both the sealed segments and the write segment
+        vector<int> removed;
+        for (int i = 0; i < 100; ++i) {
+            removed.push_back(uniform_int_distribution<int>(0, first + batch_size - 1)(generator));
+        }
+        expected.RemoveDocuments(removed);
+        versioned.RemoveDocuments(removed);
+        versioned.RemoveDocument(first);
+        expected.RemoveDocument(first);
+        if ((first / batch_size) % 4 == 0) {
+            versioned.Publish();
+            assert_same_results("after adding "s + to_string(first));
+        }
+    }
+    versioned.Publish();
+    assert_same_results("published"s);
+    versioned.WaitForMerges();
+    // the write segment was sealed five times besides the initial segment, so some merged
+    ASSERT_HINT(versioned.GetVersion()->GetSegments().size() < 6, "segments merged"s);
+    assert_same_results("merged"s);
+
+    // invalid queries are rejected once for all segments, and with no segments at all
+    VersionedSearchServer empty(SearchServer("and with"s));
+    ASSERT_HINT(empty.GetVersion()->GetSegments().empty(), "no segments"s);
+    for (const string& query : {"w1 --w2"s, "w1 -"s, "w1 w\x01"s}) {
+        const auto is_rejected = [&query](const auto& search) {
+            try {
+                search(query);
+            } catch (const invalid_argument&) {
+                return true;
+            }
+            return false;
+        };
+        ASSERT_HINT(is_rejected([&](const string& q) { return versioned.FindTopDocuments(q); }), query);
+        ASSERT_HINT(is_rejected([&](const string& q) { return versioned.FindTopDocuments(execution::par, q); }), query);
+        ASSERT_HINT(is_rejected([&](const string& q) { return empty.FindTopDocuments(q); }), "no segments: "s + query);
+        ASSERT_HINT(is_rejected([&](const string& q) { return empty.FindTopDocuments(execution::par, q); }),
+                    "no segments: "s + query);
+    }
+}
+
+void TestDuplicates() {
+    SearchServer search_server("and with"s);
+    string shared_words;
+    for (int i = 0; i < 20; ++i) {
+        shared_words += "n"s + to_string(i) + " "s;
+    }
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7});
+    // the same set of words in another order and with other counts
+    search_server.AddDocument(2, "nasty rat funny pet pet"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {2});
+    // the status does not matter
+    search_server.AddDocument(4, "rat nasty and pet funny"s, DocumentStatus::BANNED, {3});
+    search_server.AddDocument(5, shared_words, DocumentStatus::ACTUAL, {4});
+    // 20 of 21 words shared with document 5
+    search_server.AddDocument(6, shared_words + "m0"s, DocumentStatus::ACTUAL, {5});
+    search_server.AddDocument(7, "n0 n1 n2 and other words"s, DocumentStatus::ACTUAL, {6});
+    ASSERT_HINT(search_server.GetDocumentFingerprint(1) == search_server.GetDocumentFingerprint(2), "same words"s);
+    ASSERT_HINT(search_server.GetDocumentFingerprint(1) != search_server.GetDocumentFingerprint(3), "other words"s);
+    ASSERT_HINT((FindDuplicates(search_server) == vector<int>{2, 4}), "duplicates"s);
+
+    const vector<NearDuplicate> near_duplicates = FindNearDuplicates(search_server, 0.9);
+    const vector<tuple<int, int, double>> expected_near_duplicates = {{2, 1, 1.0}, {4, 1, 1.0}, {6, 5, 20.0 / 21.0}};
+    ASSERT_HINT(near_duplicates.size() == expected_near_duplicates.size(), "near duplicates"s);
+    for (size_t i = 0; i < near_duplicates.size(); ++i) {
+        const auto [document_id, original_id, similarity] = expected_near_duplicates[i];
+        ASSERT_HINT(near_duplicates[i].document_id == document_id && near_duplicates[i].original_id == original_id
+                    && abs(near_duplicates[i].similarity - similarity) < 1e-9, "near duplicate "s + to_string(document_id));
+    }
+
+    // rejected against the index and against an earlier document of the same batch
+    search_server.SetDuplicateRejection(true);
+    search_server.AddDocuments({{8, "pet rat funny nasty"s, DocumentStatus::ACTUAL, {1}},
+                                {9, "brand new words"s, DocumentStatus::ACTUAL, {1}},
+                                {10, "words new brand brand"s, DocumentStatus::ACTUAL, {1}}});
+    search_server.AddDocument(11, "funny pet"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_HINT(search_server.GetRejectedDuplicateCount() == 2, "rejected count"s);
+    ASSERT_HINT(!search_server.ContainsDocument(8) && !search_server.ContainsDocument(10), "rejected"s);
+    ASSERT_HINT(search_server.ContainsDocument(9) && search_server.ContainsDocument(11), "accepted"s);
+    ASSERT_HINT(search_server.GetDocumentFreq("brand"sv) == 1, "words of rejected documents"s);
+    search_server.SetDuplicateRejection(false);
+    search_server.AddDocument(12, "funny rat pet nasty"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_HINT(search_server.ContainsDocument(12), "rejection disabled"s);
+
+    RemoveDuplicates(search_server);
+    ASSERT_HINT(FindDuplicates(search_server).empty(), "duplicates removed"s);
+    ASSERT_HINT((vector<int>(search_server.begin(), search_server.end()) == vector<int>{1, 3, 5, 6, 7, 9, 11}),
+                "originals kept"s);
+}
+
+void TestRemoveDocuments() {
+    const vector<string> texts = GenerateTexts(3000, 400, 23);
+    const vector<string> queries = GenerateQueries(200, 450, 24);
+    const size_t vocabulary_size = 400;
+    SearchServer one_by_one("and with"s);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        one_by_one.AddDocument(id, texts[id], id % 7 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL, {id % 9});
+    }
+    SearchServer batched = one_by_one;
+    SearchServer parallel = one_by_one;
+
+    // enough ids to renumber the ordinals, some of them twice and some unknown
+    mt19937 generator(25);
+    vector<int> removed;
+    set<int> removed_known;
+    for (int i = 0; i < 1500; ++i) {
+        removed.push_back(uniform_int_distribution<int>(0, texts.size() + 200)(generator));
+        if (removed.back() < static_cast<int>(texts.size())) {
+            removed_known.insert(removed.back());
+        }
+    }
+    for (const int id : removed) {
+        one_by_one.RemoveDocument(id);
+    }
+    size_t retired_count = 0;
+    for (size_t word = 0; word < vocabulary_size; ++word) {
+        const string text = "w"s + to_string(word);
+        retired_count += batched.GetDocumentFreq(text) > 0 && one_by_one.GetDocumentFreq(text) == 0;
+    }
+    ASSERT_HINT(retired_count > 0, "some words are only in removed documents"s);
+
+    const RemovalStats stats = batched.RemoveDocuments(removed);
+    const RemovalStats parallel_stats = parallel.RemoveDocuments(execution::par, removed);
+    for (const RemovalStats& removal : {stats, parallel_stats}) {
+        ASSERT_HINT(removal.removed_document_count == removed_known.size(), "removed documents"s);
+        ASSERT_HINT(removal.retired_term_count == retired_count, "retired words"s);
+        ASSERT_HINT(removal.reclaimed_bytes > 0, "reclaimed bytes"s);
+    }
+    ASSERT_HINT(parallel_stats.reclaimed_bytes == stats.reclaimed_bytes, "same bytes on all cores"s);
+
+    for (const SearchServer* search_server : {&batched, &parallel}) {
+        AssertSameResults(one_by_one, *search_server, queries);
+        ASSERT_HINT(equal(one_by_one.begin(), one_by_one.end(), search_server->begin(), search_server->end()), "ids"s);
+        for (const string& query : queries) {
+            AssertSameDocuments(one_by_one.FindTopDocuments(query, DocumentStatus::IRRELEVANT),
+                                search_server->FindTopDocuments(query, DocumentStatus::IRRELEVANT), query);
+        }
+        for (size_t word = 0; word < vocabulary_size; ++word) {
+            const string text = "w"s + to_string(word);
+            ASSERT_HINT(one_by_one.GetDocumentFreq(text) == search_server->GetDocumentFreq(text), text);
+        }
+    }
+
+    const RemovalStats repeated = batched.RemoveDocuments(removed);
+    ASSERT_HINT(repeated.removed_document_count == 0 && repeated.retired_term_count == 0 && repeated.reclaimed_bytes == 0,
+                "nothing left to remove"s);
+}
+
+void TestTokenizer() {
+    const auto split = [](string_view text) {
+        vector<string_view> words;
+        size_t start = 0;
+        for (size_t i = 0; i <= text.size(); ++i) {
+            if (i == text.size() || text[i] == ' ') {
+                if (i > start) {
+                    words.push_back(text.substr(start, i - start));
+                }
+                start = i + 1;
+            }
+        }
+        return words;
+    };
+    const auto has_control = [](string_view text) {
+        return any_of(text.begin(), text.end(), [](char c) { return static_cast<unsigned char>(c) < ' '; });
+    };
+    vector<string_view> words;
+    const auto check = [&](string_view text) {
+        for (const SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2}) {
+            if (level > GetSupportedSimdLevel()) {
+                continue;
+            }
+            const string hint = "level "s + to_string(static_cast<int>(level)) + ", text of "s + to_string(text.size())
+                + " bytes"s;
+            ASSERT_HINT(SplitIntoWords(level, text, words) == !has_control(text), hint);
+            // the same views into text, not just equal words
+            const vector<string_view> expected = split(text);
+            ASSERT_HINT(words.size() == expected.size(), hint);
+            for (size_t i = 0; i < words.size(); ++i) {
+                ASSERT_HINT(words[i].data() == expected[i].data() && words[i].size() == expected[i].size(), hint);
+            }
+        }
+    };
+
+    // words of every length ending at every offset of the first blocks, at every alignment
+    const string buffer(200, 'a');
+    for (size_t offset = 0; offset < 32; ++offset) {
+        for (size_t length = 0; length <= 100; ++length) {
+            string text = buffer.substr(0, offset + length);
+            for (size_t space = offset; space < text.size(); space += 1 + length % 17) {
+                text[space] = ' ';
+            }
+            check(string_view(text).substr(offset));
+        }
+    }
+    // a word crossing every 16 and 32 byte boundary and texts ending right before, on and after it
+    for (const size_t boundary : {size_t{16}, size_t{32}, size_t{48}, size_t{64}, size_t{96}}) {
+        for (size_t start = boundary - 5; start < boundary; ++start) {
+            for (size_t end = boundary - 1; end <= boundary + 5; ++end) {
+                string text = string(start, ' ') + string(end - start, 'b');
+                check(text);
+                check(text + " "s);
+                check(text + " tail"s);
+            }
+        }
+    }
+    // control characters at every position, among spaces, letters and bytes above 127
+    mt19937 generator(11);
+    const string alphabet = "  ab\x01\t\n\x1f\x7f\x80\xd0\xff"s;
+    for (int i = 0; i < 20000; ++i) {
+        string text(uniform_int_distribution<size_t>(0, 80)(generator), ' ');
+        for (char& c : text) {
+            c = alphabet[uniform_int_distribution<size_t>(0, alphabet.size() - 1)(generator)];
+        }
+        check(text);
+    }
+    for (size_t position = 0; position < 70; ++position) {
+        string text(70, 'c');
+        text[position] = '\x02';
+        check(text);
+    }
+
+    // queries get the tokenizer's verdict without scanning every word again
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(0, "caf\xc3\xa9 curly cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_HINT(search_server.FindTopDocuments("caf\xc3\xa9"s).size() == 1, "bytes above 127 are letters"s);
+    for (size_t position = 0; position < 40; ++position) {
+        string query = "curly cat and a rather long query string"s;
+        query[position] = '\x1f';
+        bool is_rejected = false;
+        try {
+            search_server.FindTopDocuments(query);
+        } catch (const invalid_argument&) {
+            is_rejected = true;
+        }
+        ASSERT_HINT(is_rejected, "control character at "s + to_string(position));
+    }
+}
+
+void TestQueryStream() {
+    const vector<string> texts = GenerateTexts(3000, 500, 26);
+    vector<string> queries = GenerateQueries(300, 600, 27);
+    const auto is_invalid = [](size_t index) {
+        return index % 17 == 0;
+    };
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (is_invalid(i)) {
+            queries[i] = "w1 --w2"s;
+        }
+    }
+    SearchServer search_server("and with"s);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        search_server.AddDocument(id, texts[id], id % 4 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL, {id % 9});
+    }
+
+    for (const bool ordered : {true, false}) {
+        for (const size_t max_in_flight : {size_t{1}, size_t{4}, size_t{64}}) {
+            QueryStreamOptions options;
+            options.thread_count = 4;
+            options.max_in_flight = max_in_flight;
+            options.ordered = ordered;
+            options.status = max_in_flight == 4 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL;
+            const string hint = (ordered ? "ordered, "s : "unordered, "s) + to_string(max_in_flight) + " in flight"s;
+            size_t read_count = 0;
+            size_t delivered_count = 0;
+            vector<bool> is_delivered(queries.size());
+            const size_t count = ProcessQueryStream(search_server, [&](string& query) {
+                if (read_count == queries.size()) {
+                    return false;
+                }
+                // the query about to be read takes a slot of its own
+                ASSERT_HINT(read_count - delivered_count < max_in_flight, hint);
+                query = queries[read_count++];
+                return true;
+            }, [&](QueryStreamResult&& result) {
+                ASSERT_HINT(result.index < queries.size() && !is_delivered[result.index], hint);
+                ASSERT_HINT(!ordered || result.index == delivered_count, hint);
+                is_delivered[result.index] = true;
+                ++delivered_count;
+                const string query_hint = hint + ": "s + queries[result.index];
+                if (is_invalid(result.index)) {
+                    ASSERT_HINT(result.outcome == QueryOutcome::INVALID_QUERY && result.documents.empty(), query_hint);
+                } else {
+                    ASSERT_HINT(result.outcome == QueryOutcome::OK, query_hint);
+                    AssertSameDocuments(search_server.FindTopDocuments(queries[result.index], options.status),
+                                        result.documents, query_hint);
+                }
+            }, options);
+            ASSERT_HINT(count == queries.size() && delivered_count == queries.size(), hint);
+        }
+    }
+
+    // the deadline is checked once every QueryDeadline::CHECK_INTERVAL postings, so the
+    // word must be in more documents than that
+    SearchServer common_server("and with"s);
+    for (int id = 0; id < 5000; ++id) {
+        common_server.AddDocument(id, "common w"s + to_string(id % 100), DocumentStatus::ACTUAL, {id % 9});
+    }
+    const vector<string> common_queries = {"common"s, "w1 --w2"s};
+    // the budget goes first: a result cached without it would be returned within any budget
+    for (const bool has_budget : {true, false}) {
+        QueryStreamOptions options;
+        if (has_budget) {
+            options.query_budget = chrono::nanoseconds(1);
+        }
+        vector<QueryStreamResult> results;
+        ProcessQueryStream(common_server, common_queries.begin(), common_queries.end(), [&results](QueryStreamResult&& result) {
+            results.push_back(move(result));
+        }, options);
+        ASSERT_HINT(results.size() == 2 && results[1].outcome == QueryOutcome::INVALID_QUERY, "invalid query"s);
+        if (has_budget) {
+            ASSERT_HINT(results[0].outcome == QueryOutcome::DEADLINE_EXCEEDED && results[0].documents.empty(), "deadline"s);
+        } else {
+            ASSERT_HINT(results[0].outcome == QueryOutcome::OK && results[0].documents.size() == MAX_RESULT_DOCUMENT_COUNT,
+                        "no deadline"s);
+        }
+    }
+}
+
+void TestQueryBatches() {
+    const vector<string> texts = GenerateTexts(6000, 700, 28);
+    const vector<string> queries = GenerateQueries(500, 800, 29);
+    SearchServer search_server("and with"s);
+    // every batch scores its queries rather than taking cached results
+    search_server.SetQueryCacheCapacity(0);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        search_server.AddDocument(id, texts[id], id % 5 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL, {id % 9});
+    }
+    // removed documents leave dead ordinals in the tiles
+    for (int id = 0; id < static_cast<int>(texts.size()); id += 11) {
+        search_server.RemoveDocument(id);
+    }
+    const vector<vector<Document>> expected = ProcessQueries(search_server, queries);
+    const auto assert_same = [&](const vector<vector<Document>>& batched, const string& hint) {
+        ASSERT_HINT(batched.size() == queries.size(), hint);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            AssertSameDocuments(expected[i], batched[i], hint + ": "s + queries[i]);
+        }
+    };
+    for (const size_t batch_size : {size_t{1}, size_t{7}, DEFAULT_QUERY_BATCH_SIZE, size_t{1000}}) {
+        assert_same(ProcessQueriesBatched(search_server, queries, batch_size), "batches of "s + to_string(batch_size));
+    }
+
+    const vector<vector<Document>> irrelevant = search_server.FindTopDocumentsBatch(queries, DocumentStatus::IRRELEVANT);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        AssertSameDocuments(search_server.FindTopDocuments(queries[i], DocumentStatus::IRRELEVANT), irrelevant[i],
+                            "irrelevant: "s + queries[i]);
+    }
+
+    // a batch takes the cached results and scores only the other queries
+    search_server.SetQueryCacheCapacity(QueryResultCache::DEFAULT_CAPACITY);
+    ProcessQueries(search_server, vector<string>(queries.begin(), queries.begin() + queries.size() / 2));
+    assert_same(ProcessQueriesBatched(search_server, queries), "half cached"s);
+}
+
+void TestQueryService() {
+    SearchServer search_server("and with"s);
+    // every request scores the postings of "common" rather than taking a cached result, so
+    // a single worker falls far behind requests submitted in a loop
+    search_server.SetQueryCacheCapacity(0);
+    for (int id = 0; id < 50000; ++id) {
+        search_server.AddDocument(id, "common w"s + to_string(id % 1000) + " w"s + to_string(id % 7),
+                                  DocumentStatus::ACTUAL, {id % 9});
+    }
+    const string query = "common w1 w2"s;
+    const vector<Document> expected = search_server.FindTopDocuments(query);
+    const size_t request_count = 200;
+    const size_t max_queue_depth = 4;
+
+    for (const QueueOverflow overflow : {QueueOverflow::REJECT_NEW, QueueOverflow::SHED_OLDEST}) {
+        const string hint = overflow == QueueOverflow::REJECT_NEW ? "reject new"s : "shed oldest"s;
+        QueryServiceOptions options;
+        options.thread_count = 1;
+        options.max_queue_depth = max_queue_depth;
+        options.overflow = overflow;
+        QueryService service(search_server, options);
+        vector<future<vector<Document>>> futures;
+        for (size_t i = 0; i < request_count; ++i) {
+            futures.push_back(service.FindTopDocumentsAsync(query));
+        }
+        vector<bool> is_rejected;
+        for (auto& future : futures) {
+            try {
+                AssertSameDocuments(expected, future.get(), hint);
+                is_rejected.push_back(false);
+            } catch (const QueryRejected&) {
+                is_rejected.push_back(true);
+            }
+        }
+        const size_t rejected_count = count(is_rejected.begin(), is_rejected.end(), true);
+        const QueryServiceStats stats = service.GetStats();
+        ASSERT_HINT(rejected_count > 0, hint);
+        if (overflow == QueueOverflow::REJECT_NEW) {
+            ASSERT_HINT(stats.accepted + stats.rejected == request_count && stats.rejected == rejected_count
+                        && stats.shed == 0, hint);
+            ASSERT_HINT(!is_rejected.front(), "the first request finds the queue empty"s);
+        } else {
+            ASSERT_HINT(stats.accepted == request_count && stats.rejected == 0 && stats.shed == rejected_count, hint);
+            ASSERT_HINT(none_of(is_rejected.end() - max_queue_depth, is_rejected.end(), [](bool rejected) { return rejected; }),
+                        "the newest requests are never shed"s);
+        }
+    }
+
+    // queries fail through their futures
+    QueryService service(search_server);
+    auto invalid = service.FindTopDocumentsAsync("w1 --w2"s);
+    auto late = service.FindTopDocumentsAsync("common"s, DocumentStatus::ACTUAL, QueryDeadline::After(chrono::nanoseconds(1)));
+    auto matched = service.MatchDocumentAsync("common w3"s, 3);
+    bool is_invalid = false;
+    try {
+        invalid.get();
+    } catch (const invalid_argument&) {
+        is_invalid = true;
+    }
+    ASSERT_HINT(is_invalid, "invalid query"s);
+    bool is_late = false;
+    try {
+        late.get();
+    } catch (const QueryDeadlineExceeded&) {
+        is_late = true;
+    }
+    ASSERT_HINT(is_late, "deadline"s);
+    ASSERT_HINT(matched.get() == search_server.MatchDocument("common w3"s, 3), "matched words"s);
+
+    // a stopping service fails the requests still queued
+    vector<future<vector<Document>>> abandoned;
+    {
+        QueryServiceOptions options;
+        options.thread_count = 1;
+        QueryService stopping(search_server, options);
+        for (size_t i = 0; i < 50; ++i) {
+            abandoned.push_back(stopping.FindTopDocumentsAsync(query));
+        }
+    }
+    size_t stopped_count = 0;
+    for (auto& future : abandoned) {
+        try {
+            AssertSameDocuments(expected, future.get(), "stopped"s);
+        } catch (const QueryRejected&) {
+            ++stopped_count;
+        }
+    }
+    ASSERT_HINT(stopped_count > 0, "stopped"s);
+}
+
+void TestShardedSearchServer() {
+    const vector<string> texts = GenerateTexts(4000, 700, 12);
+    const vector<string> queries = GenerateQueries(200, 800, 13);
+    SearchServer expected("and with"s);
+    ShardedSearchServer sharded(4, "and with"s);
+    const auto status_of = [](int id) {
+        return id % 5 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL;
+    };
+    const int single_count = 500;
+    for (int id = 0; id < single_count; ++id) {
+        expected.AddDocument(id, texts[id], status_of(id), {id % 13 - 6});
+        sharded.AddDocument(id, texts[id], status_of(id), {id % 13 - 6});
+    }
+    vector<NewDocument> documents;
+    for (int id = single_count; id < static_cast<int>(texts.size()); ++id) {
+        documents.push_back({id, texts[id], status_of(id), {id % 13 - 6}});
+    }
+    expected.AddDocuments(documents);
+    sharded.AddDocuments(documents);
+
+    const auto is_even = [](int document_id, DocumentStatus status, int rating) {
+        return document_id % 2 == 0;
+    };
+    const auto assert_same_results = [&](const string& hint) {
+        ASSERT_HINT(sharded.GetDocumentCount() == expected.GetDocumentCount(), hint);
+        for (const string& query : queries) {
+            const string query_hint = hint + ": "s + query;
+            AssertSameDocuments(expected.FindTopDocuments(query), sharded.FindTopDocuments(query), query_hint);
+            AssertSameDocuments(expected.FindTopDocuments(query), sharded.FindTopDocuments(execution::par, query), query_hint);
+            AssertSameDocuments(expected.FindTopDocuments(query, DocumentStatus::IRRELEVANT),
+                                sharded.FindTopDocuments(query, DocumentStatus::IRRELEVANT), query_hint);
+            AssertSameDocuments(expected.FindTopDocuments(query, is_even), sharded.FindTopDocuments(query, is_even), query_hint);
+        }
+        for (const int id : expected) {
+            if (id % 89 == 0) {
+                ASSERT_HINT(expected.MatchDocument(queries[id % queries.size()], id)
+                            == sharded.MatchDocument(queries[id % queries.size()], id), hint);
+                const string word = "w"s + to_string(id % 700);
+                ASSERT_HINT(expected.GetDocumentFreq(word) == sharded.GetDocumentFreq(word), hint);
+            }
+        }
+        ASSERT_HINT(equal(expected.begin(), expected.end(), sharded.begin(), sharded.end()), hint);
+    };
+    assert_same_results("added"s);
+
+    // removals change the document frequencies every shard ranks with
+    mt19937 generator(14);
+    vector<int> removed;
+    for (int i = 0; i < 600; ++i) {
+        removed.push_back(uniform_int_distribution<int>(0, static_cast<int>(texts.size()) - 1)(generator));
+    }
+    expected.RemoveDocuments(removed);
+    sharded.RemoveDocuments(removed);
+    for (int id = 1; id < static_cast<int>(texts.size()); id += 101) {
+        expected.RemoveDocument(id);
+        sharded.RemoveDocument(execution::par, id);
+    }
+    assert_same_results("removed"s);
+}
+
+void TestDistributedSearch() {
+    const vector<string> texts = GenerateTexts(3000, 600, 15);
+    const vector<string> queries = GenerateQueries(200, 700, 16);
+    const size_t worker_count = 3;
+    const auto status_of = [](int id) {
+        return id % 6 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL;
+    };
+    SearchServer expected("and with"s);
+    vector<SearchServer> partitions(worker_count, SearchServer("and with"s));
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        expected.AddDocument(id, texts[id], status_of(id), {id % 11 - 5});
+        partitions[id % worker_count].AddDocument(id, texts[id], status_of(id), {id % 11 - 5});
+    }
+
+    // the workers are indexed before forking, so they only serve in the child processes
+    vector<string> socket_paths;
+    vector<pid_t> workers;
+    for (size_t worker = 0; worker < worker_count; ++worker) {
+        socket_paths.push_back("/tmp/search-worker-"s + to_string(getpid()) + "-"s + to_string(worker) + ".sock"s);
+        const pid_t pid = fork();
+        if (pid == 0) {
+            SearchWorker search_worker(partitions[worker], socket_paths.back());
+            // serves until the test kills the process
+            search_worker.Serve();
+            _exit(0);
+        }
+        ASSERT_HINT(pid > 0, "fork"s);
+        workers.push_back(pid);
+    }
+    const auto connect = [&socket_paths] {
+        // a worker accepts connections once it listens
+        for (int attempt = 0;; ++attempt) {
+            try {
+                return make_unique<SearchCoordinator>(socket_paths);
+            } catch (const runtime_error&) {
+                ASSERT_HINT(attempt < 500, "workers listen"s);
+                this_thread::sleep_for(chrono::milliseconds(10));
+            }
+        }
+    };
+
+    unique_ptr<SearchCoordinator> coordinator = connect();
+    ASSERT_HINT(coordinator->GetDocumentCount() == expected.GetDocumentCount(), "document count"s);
+    for (const string& query : queries) {
+        AssertSameDocuments(expected.FindTopDocuments(query), coordinator->FindTopDocuments(query), query);
+        AssertSameDocuments(expected.FindTopDocuments(query, DocumentStatus::IRRELEVANT),
+                            coordinator->FindTopDocuments(query, DocumentStatus::IRRELEVANT), query);
+    }
+    // an invalid query is the caller's error and leaves the connections usable
+    bool is_rejected = false;
+    try {
+        coordinator->FindTopDocuments("w1 --w2"s);
+    } catch (const invalid_argument&) {
+        is_rejected = true;
+    }
+    ASSERT_HINT(is_rejected, "invalid query"s);
+    AssertSameDocuments(expected.FindTopDocuments(queries[0]), coordinator->FindTopDocuments(queries[0]), "after invalid query"s);
+
+    // workers keep serving coordinators that come and go
+    for (int i = 0; i < 20; ++i) {
+        const string& query = queries[i];
+        AssertSameDocuments(expected.FindTopDocuments(query), connect()->FindTopDocuments(query), "reconnected: "s + query);
+    }
+
+    // once a worker is gone the coordinator fails every query, not just the first
+    kill(workers.back(), SIGTERM);
+    waitpid(workers.back(), nullptr, 0);
+    for (int i = 0; i < 3; ++i) {
+        bool is_failed = false;
+        try {
+            coordinator->FindTopDocuments(queries[i]);
+        } catch (const runtime_error&) {
+            is_failed = true;
+        }
+        ASSERT_HINT(is_failed, "query "s + to_string(i) + " after a worker died"s);
+    }
+
+    coordinator.reset();
+    for (size_t worker = 0; worker < worker_count; ++worker) {
+        kill(workers[worker], SIGTERM);
+        waitpid(workers[worker], nullptr, 0);
+        unlink(socket_paths[worker].c_str());
+    }
+}
+
+void TestSearchServer() {
+    RUN_TEST(TestSnapshots);
+    RUN_TEST(TestTermRetirement);
+    RUN_TEST(TestPostingLists);
+    RUN_TEST(TestPrunedEvaluation);
+    RUN_TEST(TestMinusWordBitmaps);
+    RUN_TEST(TestQueryResultCache);
+    RUN_TEST(TestVersionedSearchServer);
+    RUN_TEST(TestDuplicates);
+    RUN_TEST(TestRemoveDocuments);
+    RUN_TEST(TestTokenizer);
+    RUN_TEST(TestQueryStream);
+    RUN_TEST(TestQueryBatches);
+    RUN_TEST(TestQueryService);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestDistributedSearch);
+}
+
+void RunBenchmarks() {
+    const vector<string> texts = GenerateTexts(100000, 20000, 100);
+    const vector<string> queries = GenerateQueries(2000, 20000, 101);
+    SearchServer search_server("and with"s);
+    vector<NewDocument> documents;
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        documents.push_back({id, texts[id], DocumentStatus::ACTUAL, {id % 10}});
+    }
+    search_server.AddDocuments(documents);
+
+    BenchmarkQueryPartitions(search_server, queries, 8);
+    BenchmarkPostingLists(1000000, 5000000);
+    BenchmarkQueryEvaluation(search_server, queries);
+    BenchmarkTokenizer(1 << 20);
+    BenchmarkStopWords(500, 1000000);
+    BenchmarkQueryStream(search_server, queries, 64);
+    BenchmarkQueryBatches(search_server, queries, 64);
+    BenchmarkQueryService(search_server, queries, 4, 256);
+}
@@ -8,3 +8,103 @@ void MatchDocuments(SearchServer& search_server, std::string& text);
 void FindTopDocuments(SearchServer& search_server, std::string& text);
 
 void AddDocument(SearchServer& search_server, int id, std::string& text, DocumentStatus status, std::vector<int>& ratings);
+
+
+// Logs the time of the same parallel queries with 1, 2, 4, ... max_partition_count partitions
+void BenchmarkQueryPartitions(SearchServer& search_server, const std::vector<std::string>& queries, size_t max_partition_count);
+
+// Logs the time of the same queries evaluated exhaustively and with pruning
+void BenchmarkQueryEvaluation(SearchServer& search_server, const std::vector<std::string>& queries);
+
+// Builds a posting list of posting_count random postings over document_count documents and
+// compares its size and decode time with plain ordinal and term frequency arrays
+void BenchmarkPostingLists(size_t document_count, size_t posting_count);
+
+// Logs the throughput of splitting a text of text_size bytes with every supported instruction set
+void BenchmarkTokenizer(size_t text_size);
+
+// Compares stop word lookups of random words in a std::set and in a StopWordSet of
+// stop_word_count words
+void BenchmarkStopWords(size_t stop_word_count, size_t lookup_count);
+
+// Logs the time of the same queries run by ProcessQueries and streamed through
+// ProcessQueryStream with at most max_in_flight queries held at once
+void BenchmarkQueryStream(const SearchServer& search_server, const std::vector<std::string>& queries, size_t max_in_flight);
+
+// Logs the time of the same queries run one at a time by ProcessQueries and term at a time
+// in batches of batch_size by ProcessQueriesBatched
+void BenchmarkQueryBatches(const SearchServer& search_server, const std::vector<std::string>& queries, size_t batch_size);
+
+// Logs the time of the same queries submitted at once to a QueryService with
+// thread_count workers and a queue of max_queue_depth requests, and how many it rejected
+void BenchmarkQueryService(const SearchServer& search_server, const std::vector<std::string>& queries,
+                           size_t thread_count, size_t max_queue_depth);
+
+// The tests below abort with the failed check and a hint when the index misbehaves
+
+// Saves a snapshot, loads it, compares the results with the original server and updates the
+// loaded server; truncated snapshots and snapshots of another version must be rejected
+void TestSnapshots();
+
+// Views of words returned by the server must survive removals of other documents, and
+// retired term ids must be reused so the dictionary does not grow as documents churn
+void TestTermRetirement();
+
+// Random additions, removals and seals of a posting list must keep the same postings as a
+// plain map, and sealed lists must be smaller than uncompressed postings
+void TestPostingLists();
+
+// Pruned evaluation must return the same documents as the exhaustive one, with relevance
+// ties at the edge of the top broken by rating the same way
+void TestPrunedEvaluation();
+
+// Queries with a minus word frequent enough to be excluded through a bitmap must return the
+// documents without it, also after documents are removed, re-added and renumbered
+void TestMinusWordBitmaps();
+
+// Cached results must be dropped by every change of the index, so a query by status returns
+// the same documents as an uncached one, and the hits and misses must be counted
+void TestQueryResultCache();
+
+// A VersionedSearchServer must return the same documents as one SearchServer given the
+// same additions and removals, before and after its segments are merged
+void TestVersionedSearchServer();
+
+// Documents with the same set of words must be found and removed as duplicates, similar ones
+// found as near duplicates, and rejected on adding while rejection is enabled
+void TestDuplicates();
+
+// RemoveDocuments must leave the index RemoveDocument leaves for the same ids, on one core or
+// on all, and report what it removed, retired and reclaimed
+void TestRemoveDocuments();
+
+// Every supported instruction set must split texts into the same words as a plain loop and
+// report the same control characters, whatever the length and alignment of the text
+void TestTokenizer();
+
+// ProcessQueryStream must deliver every query once, in stream order when asked to, with no
+// more queries in flight than allowed, and report invalid and timed out queries
+void TestQueryStream();
+
+// ProcessQueriesBatched must return the documents of ProcessQueries whatever the batch size
+// and whichever queries are already cached, up to the order of full ties
+void TestQueryBatches();
+
+// A QueryService must reject new or shed old requests once its queue is full, as configured,
+// and deliver the exceptions of queries and of stopping through the futures
+void TestQueryService();
+
+// A ShardedSearchServer must return the same documents as one SearchServer given the same
+// additions and removals, since its shards rank with the frequencies of the whole collection
+void TestShardedSearchServer();
+
+// Forks SearchWorker processes over partitions of the documents; a SearchCoordinator over
+// them must return the same documents as one SearchServer of all of them, and must fail
+// every query once a worker is gone
+void TestDistributedSearch();
+
+// Runs all tests
+void TestSearchServer();
+
+// Runs all benchmarks on generated documents; they log times and assert nothing
+void RunBenchmarks();
@@ -0,0 +1,14 @@
+#include "../test_example_functions.h"
+
+#include <string_view>
+
+using namespace std;
+
+// Runs the tests, then the benchmarks if --benchmark is given
+int main(int argc, char* argv[]) {
+    TestSearchServer();
+    if (argc > 1 && argv[1] == "--benchmark"sv) {
+        RunBenchmarks();
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (abs(lhs.relevance - rhs.relevance) < CORRECTION) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+TopDocumentsCollector::TopDocumentsCollector(size_t limit)
+    : limit_(limit)
+{
+}
+
+void TopDocumentsCollector::Add(const Document& document) {
+    if (heap_.size() < limit_) {
+        heap_.push_back(document);
+        push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    } else if (limit_ > 0 && IsMoreRelevant(document, heap_.front())) {
+        pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        heap_.back() = document;
+        push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+}
+
+double TopDocumentsCollector::GetMinRelevance() const {
+    if (limit_ == 0) {
+        return numeric_limits<double>::infinity();
+    }
+    if (heap_.size() < limit_) {
+        return -numeric_limits<double>::infinity();
+    }
+    // a document within CORRECTION of the least relevant one may still win on rating
+    return heap_.front().relevance - CORRECTION;
+}
+
+void TopDocumentsCollector::Merge(const TopDocumentsCollector& other) {
+    for (const Document& document : other.heap_) {
+        Add(document);
+    }
+}
+
+vector<Document> TopDocumentsCollector::Extract() {
+    sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    return move(heap_);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include "document.h"
+
+const double CORRECTION = 1e-6;
+
+// Relevance descending; relevances closer than CORRECTION are ordered by rating
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Keeps the `limit` most relevant documents out of everything passed to Add
+// in a bounded heap, so selecting K of N documents costs O(N log K).
+class TopDocumentsCollector {
+public:
+    explicit TopDocumentsCollector(size_t limit);
+
+    void Add(const Document& document);
+
+    // Documents with relevance below this can not be kept any more: -infinity until the
+    // collector is full, then CORRECTION below the least relevant kept document
+    double GetMinRelevance() const;
+
+    // Combines the results of two collectors that saw disjoint documents
+    void Merge(const TopDocumentsCollector& other);
+
+    // Returns the collected documents, most relevant first
+    std::vector<Document> Extract();
+
+private:
+    size_t limit_;
+    // heap_.front() is the least relevant of the kept documents
+    std::vector<Document> heap_;
+};
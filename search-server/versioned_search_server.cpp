@@ -0,0 +1,257 @@
+#include "versioned_search_server.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// Removes the sources from segments and returns where the first of them was
+template <typename Segment>
+size_t EraseSources(vector<Segment>& segments, const vector<SegmentedIndex::Segment>& sources) {
+    size_t first = segments.size();
+    for (const auto& source : sources) {
+        const auto it = find_if(segments.begin(), segments.end(),
+                                [&source](const Segment& segment) { return segment.index == source.index; });
+        first = min(first, static_cast<size_t>(it - segments.begin()));
+        segments.erase(it);
+    }
+    return first;
+}
+
+// Removals recorded after the first skipped ones, applied to the merged index
+void AddLaterRemovals(const SegmentDeletes* deletes, size_t skipped, const SearchServer& merged,
+                      SegmentDeletes& merged_deletes) {
+    if (!deletes) {
+        return;
+    }
+    for (size_t i = skipped; i < deletes->removed_ids.size(); ++i) {
+        merged_deletes.Add(merged, deletes->removed_ids[i]);
+    }
+}
+
+} // namespace
+
+VersionedSearchServer::VersionedSearchServer(SearchServer search_server)
+    : prototype_(search_server.CloneEmpty())
+    , write_segment_(make_unique<SearchServer>(prototype_.CloneEmpty())) {
+    if (search_server.GetDocumentCount() > 0) {
+        search_server.CompactPostings();
+        segments_.push_back({make_shared<const SearchServer>(move(search_server)), nullptr});
+    }
+    Publish();
+    merge_thread_ = thread([this] { MergeSegments(); });
+}
+
+VersionedSearchServer::~VersionedSearchServer() {
+    {
+        lock_guard guard(update_mutex_);
+        is_stopping_ = true;
+    }
+    merge_condition_.notify_all();
+    merge_thread_.join();
+}
+
+VersionedSearchServer::Version VersionedSearchServer::GetVersion() const {
+    return atomic_load(&published_);
+}
+
+uint64_t VersionedSearchServer::GetVersionNumber() const {
+    return version_number_.load(memory_order_acquire);
+}
+
+int VersionedSearchServer::GetDocumentCount() const {
+    return GetVersion()->GetDocumentCount();
+}
+
+void VersionedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status,
+                                        const vector<int>& ratings) {
+    AddDocuments({NewDocument{document_id, document, status, ratings}});
+}
+
+void VersionedSearchServer::AddDocuments(const vector<NewDocument>& documents) {
+    lock_guard guard(update_mutex_);
+    CheckNewIds(documents);
+    write_segment_->AddDocuments(documents);
+    is_write_segment_changed_ = true;
+    if (write_segment_->GetDocumentCount() >= WRITE_SEGMENT_DOCUMENT_COUNT) {
+        SealWriteSegment();
+    }
+}
+
+void VersionedSearchServer::RemoveDocument(int document_id) {
+    RemoveDocuments({document_id});
+}
+
+void VersionedSearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    lock_guard guard(update_mutex_);
+    vector<int> write_segment_ids;
+    for (const int document_id : document_ids) {
+        if (write_segment_->ContainsDocument(document_id)) {
+            write_segment_ids.push_back(document_id);
+        } else {
+            RemoveFromSealedSegment(document_id);
+        }
+    }
+    if (!write_segment_ids.empty()) {
+        write_segment_->RemoveDocuments(write_segment_ids);
+        is_write_segment_changed_ = true;
+    }
+}
+
+void VersionedSearchServer::Publish() {
+    lock_guard guard(update_mutex_);
+    if (is_write_segment_changed_) {
+        // the only copy publishing makes, bounded by WRITE_SEGMENT_DOCUMENT_COUNT
+        published_write_segment_ = write_segment_->GetDocumentCount() > 0
+            ? make_shared<const SearchServer>(*write_segment_)
+            : nullptr;
+        is_write_segment_changed_ = false;
+    }
+    published_segments_.clear();
+    for (SealedSegment& segment : segments_) {
+        published_segments_.push_back({segment.index, segment.deletes});
+        segment.is_deletes_published = true;
+    }
+    PublishVersion();
+}
+
+void VersionedSearchServer::WaitForMerges() {
+    unique_lock lock(update_mutex_);
+    merge_condition_.wait(lock, [this] { return !is_merging_ && SelectMerge().empty(); });
+}
+
+void VersionedSearchServer::CheckNewIds(const vector<NewDocument>& documents) const {
+    // the write segment checks its own documents
+    for (const NewDocument& document : documents) {
+        for (const SealedSegment& segment : segments_) {
+            if (segment.index->ContainsDocument(document.id)
+                && (!segment.deletes || !segment.deletes->Contains(document.id))) {
+                throw invalid_argument("invalid id");
+            }
+        }
+    }
+}
+
+void VersionedSearchServer::RemoveFromSealedSegment(int document_id) {
+    for (SealedSegment& segment : segments_) {
+        if (!segment.index->ContainsDocument(document_id) || (segment.deletes && segment.deletes->Contains(document_id))) {
+            continue;
+        }
+        if (!segment.deletes) {
+            segment.deletes = make_shared<SegmentDeletes>();
+        } else if (segment.is_deletes_published) {
+            segment.deletes = make_shared<SegmentDeletes>(*segment.deletes);
+        }
+        segment.is_deletes_published = false;
+        segment.deletes->Add(*segment.index, document_id);
+        return;
+    }
+}
+
+void VersionedSearchServer::SealWriteSegment() {
+    write_segment_->CompactPostings();
+    segments_.push_back({shared_ptr<const SearchServer>(move(write_segment_)), nullptr});
+    write_segment_ = make_unique<SearchServer>(prototype_.CloneEmpty());
+    is_write_segment_changed_ = true;
+}
+
+void VersionedSearchServer::PublishVersion() {
+    vector<SegmentedIndex::Segment> segments = published_segments_;
+    if (published_write_segment_) {
+        segments.push_back({published_write_segment_, nullptr});
+    }
+    atomic_store(&published_, make_shared<const SegmentedIndex>(move(segments),
+                                                                 prototype_.GetMaxResultDocumentCount()));
+    version_number_.fetch_add(1, memory_order_release);
+    merge_condition_.notify_all();
+}
+
+vector<size_t> VersionedSearchServer::SelectMerge() const {
+    // tier t holds segments of up to WRITE_SEGMENT_DOCUMENT_COUNT * SEGMENT_MERGE_FACTOR^t live documents
+    map<int, vector<size_t>> tiers;
+    for (size_t i = 0; i < published_segments_.size(); ++i) {
+        const SegmentedIndex::Segment& segment = published_segments_[i];
+        // a segment with mostly removed documents is rewritten on its own
+        if (segment.deletes && segment.deletes->removed_ids.size() * 2 >= static_cast<size_t>(segment.index->GetDocumentCount())) {
+            return {i};
+        }
+        int tier = 0;
+        for (int64_t size = WRITE_SEGMENT_DOCUMENT_COUNT; size < segment.GetDocumentCount(); size *= SEGMENT_MERGE_FACTOR) {
+            ++tier;
+        }
+        tiers[tier].push_back(i);
+    }
+    for (auto& [tier, positions] : tiers) {
+        if (positions.size() >= SEGMENT_MERGE_FACTOR) {
+            positions.resize(SEGMENT_MERGE_FACTOR);
+            return positions;
+        }
+    }
+    return {};
+}
+
+void VersionedSearchServer::MergeSegments() {
+    unique_lock lock(update_mutex_);
+    while (true) {
+        vector<size_t> positions;
+        merge_condition_.wait(lock, [&] {
+            return is_stopping_ || !(positions = SelectMerge()).empty();
+        });
+        if (is_stopping_) {
+            return;
+        }
+        vector<SegmentedIndex::Segment> sources;
+        vector<SearchServer::DocumentSource> document_sources;
+        for (const size_t position : positions) {
+            sources.push_back(published_segments_[position]);
+            const auto& deletes = sources.back().deletes;
+            document_sources.push_back({sources.back().index.get(), deletes ? &deletes->document_ids : nullptr});
+        }
+        is_merging_ = true;
+
+        // the published sources are immutable, so updates and queries go on during the merge
+        lock.unlock();
+        auto merged = make_shared<SearchServer>(prototype_.CloneEmpty());
+        merged->AddDocumentsFrom(document_sources);
+        merged->CompactPostings();
+        lock.lock();
+
+        ReplaceSegments(sources, move(merged));
+        is_merging_ = false;
+        merge_condition_.notify_all();
+    }
+}
+
+void VersionedSearchServer::ReplaceSegments(const vector<SegmentedIndex::Segment>& sources,
+                                            shared_ptr<const SearchServer> merged) {
+    // the merge dropped the removals published with the sources; later ones move to the merged segment
+    auto deletes = make_shared<SegmentDeletes>();
+    auto published_deletes = make_shared<SegmentDeletes>();
+    for (const SegmentedIndex::Segment& source : sources) {
+        const size_t merged_removals = source.deletes ? source.deletes->removed_ids.size() : 0;
+        const auto segment = find_if(segments_.begin(), segments_.end(),
+                                     [&source](const SealedSegment& segment) { return segment.index == source.index; });
+        const auto published = find_if(published_segments_.begin(), published_segments_.end(),
+                                       [&source](const SegmentedIndex::Segment& segment) { return segment.index == source.index; });
+        AddLaterRemovals(segment->deletes.get(), merged_removals, *merged, *deletes);
+        AddLaterRemovals(published->deletes.get(), merged_removals, *merged, *published_deletes);
+    }
+    // published removals are a prefix of the working ones, so equal sizes mean equal contents
+    const bool is_deletes_published = deletes->removed_ids.size() == published_deletes->removed_ids.size();
+    if (is_deletes_published) {
+        deletes = published_deletes;
+    }
+
+    const size_t position = EraseSources(segments_, sources);
+    const size_t published_position = EraseSources(published_segments_, sources);
+    if (merged->GetDocumentCount() > 0) {
+        segments_.insert(segments_.begin() + position,
+                         {merged, deletes->removed_ids.empty() ? nullptr : deletes, is_deletes_published});
+        published_segments_.insert(published_segments_.begin() + published_position,
+                                   {merged, published_deletes->removed_ids.empty() ? nullptr : published_deletes});
+    }
+    PublishVersion();
+}
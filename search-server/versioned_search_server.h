@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "segmented_index.h"
+
+// Documents are added to a small write segment, which is sealed into an immutable segment
+// once it holds this many
+const int WRITE_SEGMENT_DOCUMENT_COUNT = 4096;
+// Segments of similar size are merged once there are this many of them
+const size_t SEGMENT_MERGE_FACTOR = 4;
+
+// Serves queries from immutable published versions of the index while updates are
+// applied to a private working index. A query pins the version that is current when it
+// starts and keeps it alive until it ends, so queries never wait for updates and updates
+// never wait for queries. Updates become visible together on Publish(); a version is
+// freed when the last query pinning it ends.
+//
+// The index is log-structured: new documents go to the write segment, removals from
+// sealed segments are recorded in their SegmentDeletes, and a background thread merges
+// sealed segments of the same size tier, dropping removed documents. Publishing shares
+// the sealed segments between versions and copies only the write segment.
+class VersionedSearchServer {
+public:
+    using Version = std::shared_ptr<const SegmentedIndex>;
+
+    // The documents of search_server become the first sealed segment; its stop words and
+    // settings apply to all segments
+    explicit VersionedSearchServer(SearchServer search_server);
+
+    ~VersionedSearchServer();
+
+    // The latest published version. MatchDocument returns views into it, so keep it
+    // while the results are used.
+    Version GetVersion() const;
+
+    // Grows by one on every Publish and every finished merge
+    uint64_t GetVersionNumber() const;
+
+    // Runs on a single version pinned for the call
+    template <typename... Args>
+    std::vector<Document> FindTopDocuments(Args&&... args) const;
+
+    int GetDocumentCount() const;
+
+    // Updates are serialized among themselves and invisible to queries until Publish
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void AddDocuments(const std::vector<NewDocument>& documents);
+    void RemoveDocument(int document_id);
+    // Sealed segments only record the removals; merges reclaim the space
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    // Makes the updates applied so far visible to the queries that start afterwards
+    void Publish();
+
+    // Blocks until no merge is due among the published segments
+    void WaitForMerges();
+
+private:
+    struct SealedSegment {
+        std::shared_ptr<const SearchServer> index;
+        std::shared_ptr<SegmentDeletes> deletes;
+        // a published SegmentDeletes is copied before the next removal changes it
+        bool is_deletes_published = false;
+    };
+
+    const SearchServer prototype_;
+    std::mutex update_mutex_;
+    std::unique_ptr<SearchServer> write_segment_;
+    bool is_write_segment_changed_ = false;
+    std::vector<SealedSegment> segments_;
+    // the sealed segments and write segment of the published version
+    std::vector<SegmentedIndex::Segment> published_segments_;
+    std::shared_ptr<const SearchServer> published_write_segment_;
+    // read and replaced only through std::atomic_load and std::atomic_store
+    Version published_;
+    std::atomic<uint64_t> version_number_{0};
+
+    std::condition_variable merge_condition_;
+    bool is_merging_ = false;
+    bool is_stopping_ = false;
+    std::thread merge_thread_;
+
+    void CheckNewIds(const std::vector<NewDocument>& documents) const;
+
+    // Records the removal in the deletes of the sealed segment holding the document, if any
+    void RemoveFromSealedSegment(int document_id);
+
+    void SealWriteSegment();
+
+    // Publishes published_segments_ and published_write_segment_ as a new version
+    void PublishVersion();
+
+    // Positions in published_segments_ of the segments to merge next, empty if none is due
+    std::vector<size_t> SelectMerge() const;
+
+    void MergeSegments();
+
+    // Swaps the merged segment in for its sources and publishes the result
+    void ReplaceSegments(const std::vector<SegmentedIndex::Segment>& sources, std::shared_ptr<const SearchServer> merged);
+};
+
+template <typename... Args>
+std::vector<Document> VersionedSearchServer::FindTopDocuments(Args&&... args) const {
+    return GetVersion()->FindTopDocuments(std::forward<Args>(args)...);
+}